@@ -7,24 +7,58 @@
 #include <cmath>
 #include <algorithm>
 #include <numeric>
+#include <optional>
+#include <tuple>
+#include <string>
+#include <cstdint>
 /*
  * Solver for the problem of congruences:
  *      x = a mod n
  *      x = b mod m
- * where n,m are relative prime.
+ * The moduli do not need to be relative prime. With g = gcd(n, m) a solution exists iff a = b mod g, it is then
+ * unique modulo K = lcm(n, m). All intermediate products are formed in 128 bits so the only requirement is that
+ * K fits in 64 bits.
  * Usage:
  *      chineseremainder(int a, int n, int b, int m)
  *
- *      @param a      : Modulus
+ *      @param a      : Remainder modulo n
  *      @param n      : Modulus
- *      @param b      : Modulus
+ *      @param b      : Remainder modulo m
  *      @param m      : Modulus
  *
- *      return        :
+ *      return        : {x, K} with 0 <= x < K, or nothing if the congruences are inconsistent.
  *
+ *      chineseremainder(Congruence[] congruences)
+ *
+ *      @param congruences  : k congruences x = a_i mod n_i, folded pairwise.
+ *
+ *      return        : {x, K} with K the lcm of all moduli, or nothing if the congruences are inconsistent.
+ *
+ *      chineseremainder_batch(Query[] queries)
+ *
+ *      @param queries  : Independent two-congruence problems.
+ *
+ *      return        : The answer of every query. Consecutive queries with the same pair of moduli reuse one
+ *                      ModulusPair, whose precomputed reducers answer them without any division.
+ *
+ *      Garner(int[] moduli).reconstruct(int[] residues, int target)
+ *
+ *      @param moduli   : Pairwise coprime moduli, the inverses between them are computed once.
+ *      @param residues : x mod moduli[i] for every i.
+ *      @param target   : Modulus of the result, leave out to get x itself as 32-bit limbs.
+ *
+ *      return        : x mod target, or the limbs of x with 0 <= x < product of the moduli.
  *
  */
 
+struct Congruence{
+    int64_t a, n;
+};
+
+struct Query{
+    int64_t a, n, b, m;
+};
+
 static int64_t exteuclid(int64_t y, int64_t n){
     int64_t n_old{n};
     int64_t q, t;
@@ -43,24 +77,219 @@ static int64_t exteuclid(int64_t y, int64_t n){
     return (b < 0) ? b + n_old : b;
 }
 
-std::tuple<int64_t, int64_t> chineseremainder(int64_t a, int64_t n, int64_t b, int64_t m){
-    auto K = n * m;
-    auto M1 = K / n;
-    auto M2 = K / m;
-    auto y1 = exteuclid(M1, n);
-    auto y2 = exteuclid(M2, m);
-    auto x = (a*y1*M1 + b*y2*M2) % K;
-    return {x, K};
+static int64_t reduce(int64_t a, int64_t n){
+    a %= n;
+    return a < 0 ? a + n : a;
+}
+
+/*
+ * x mod d for a fixed 1 <= d < 2^63 without a division. mu = floor((2^64 - 1) / d) makes hi(x * mu) an estimate of
+ * the quotient that is at most one too small, so one conditional subtraction corrects the remainder.
+ */
+struct Barrett{
+    explicit Barrett(uint64_t d) : d{d}, mu{~uint64_t{0} / d}{}
+
+    uint64_t reduce(int64_t x) const{
+        if(x < 0){
+            auto r = reduce(0 - static_cast<uint64_t>(x));
+            return r ? d - r : 0;
+        }
+        return reduce(static_cast<uint64_t>(x));
+    }
+
+    uint64_t reduce(uint64_t x) const{
+        auto q = static_cast<uint64_t>((static_cast<unsigned __int128>(x) * mu) >> 64);
+        auto r = x - q * d;
+        return r >= d ? r - d : r;
+    }
+
+    uint64_t d, mu;
+};
+
+/*
+ * Divisibility test and exact division by a fixed g >= 1 with multiplications only. With g = 2^s * o and o odd, x
+ * is divisible by g iff its low s bits are zero and (x >> s) * o^-1 mod 2^64 is at most (2^64 - 1) / o, that
+ * product is then the quotient.
+ */
+struct ExactDivisor{
+    explicit ExactDivisor(uint64_t g) : shift{__builtin_ctzll(g)}, odd{g >> shift}, inv{odd}, limit{~uint64_t{0} / odd}{
+        for(int32_t i{0}; i < 5; ++i) // Newton iteration, every step doubles the number of correct bits.
+            inv *= 2 - odd * inv;
+    }
+
+    bool divide(int64_t x, int64_t& quotient) const{
+        auto u = x < 0 ? 0 - static_cast<uint64_t>(x) : static_cast<uint64_t>(x);
+        if(u & ((uint64_t{1} << shift) - 1))
+            return false;
+        auto q = (u >> shift) * inv;
+        if(q > limit)
+            return false;
+        quotient = x < 0 ? -static_cast<int64_t>(q) : static_cast<int64_t>(q);
+        return true;
+    }
+
+    int32_t shift;
+    uint64_t odd, inv, limit;
+};
+
+/*
+ * Everything about a pair of moduli that does not depend on the remainders: g = gcd(n, m), m' = m/g and the
+ * inverse of n/g modulo m'. The solution is then x = a + n * ((b - a)/g * inv mod m'). The constructor also
+ * prepares a Barrett reducer for n, m and m', the exact division by g and Shoup's precomputed quotient
+ * inv_q = floor(inv * 2^64 / m') of the fixed multiplier, so solve() only multiplies.
+ */
+struct ModulusPair{
+    ModulusPair(int64_t n, int64_t m) : n{n}, m{m}, g{std::gcd(n, m)}, m_g{m / g}, mod_n(n), mod_m(m), mod_m_g(m_g),
+                                        by_g(g){
+        inv = exteuclid(reduce(n / g, m_g), m_g) % m_g;
+        inv_q = static_cast<uint64_t>((static_cast<unsigned __int128>(inv) << 64) / static_cast<uint64_t>(m_g));
+    }
+
+    std::optional<std::tuple<int64_t, int64_t>> solve(int64_t a, int64_t b) const{
+        if(a < 0 || a >= n)
+            a = static_cast<int64_t>(mod_n.reduce(a));
+        if(b < 0 || b >= m)
+            b = static_cast<int64_t>(mod_m.reduce(b));
+        int64_t quotient;
+        if(!by_g.divide(b - a, quotient))
+            return std::nullopt;
+        auto y = mod_m_g.reduce(quotient);
+        // Shoup: hi(y * inv_q) is y * inv / m' or one less, the remainder is corrected like in Barrett.
+        auto q = static_cast<uint64_t>((static_cast<unsigned __int128>(y) * inv_q) >> 64);
+        auto t = y * static_cast<uint64_t>(inv) - q * static_cast<uint64_t>(m_g);
+        t -= t >= static_cast<uint64_t>(m_g) ? m_g : 0;
+        return std::make_tuple(static_cast<int64_t>(a + static_cast<__int128>(n) * t), n * m_g);
+    }
+
+    int64_t n, m, g, m_g, inv;
+    uint64_t inv_q;
+    Barrett mod_n, mod_m, mod_m_g;
+    ExactDivisor by_g;
+};
+
+std::optional<std::tuple<int64_t, int64_t>> chineseremainder(int64_t a, int64_t n, int64_t b, int64_t m){
+    return ModulusPair(n, m).solve(a, b);
+}
+
+std::optional<std::tuple<int64_t, int64_t>> chineseremainder(const std::vector<Congruence>& congruences){
+    std::tuple<int64_t, int64_t> acc{0, 1};
+    for(const auto& c : congruences){
+        auto next = chineseremainder(std::get<0>(acc), std::get<1>(acc), c.a, c.n);
+        if(!next)
+            return std::nullopt;
+        acc = *next;
+    }
+    return acc;
+}
+
+std::vector<std::optional<std::tuple<int64_t, int64_t>>> chineseremainder_batch(const std::vector<Query>& queries){
+    std::vector<std::optional<std::tuple<int64_t, int64_t>>> result;
+    result.reserve(queries.size());
+    std::optional<ModulusPair> pair;
+    for(const auto& q : queries){
+        if(!pair || pair->n != q.n || pair->m != q.m)
+            pair.emplace(q.n, q.m);
+        result.push_back(pair->solve(q.a, q.b));
+    }
+    return result;
+}
+
+/*
+ * Garner's algorithm reconstructs x < M = m_0*...*m_{k-1} from its residues modulo pairwise coprime m_i. x is first
+ * written in mixed radix form x = v_0 + v_1*m_0 + v_2*m_0*m_1 + ... where
+ *      v_i = (...((r_i - v_0) * m_0^-1 - v_1) * m_1^-1 - ... - v_{i-1}) * m_{i-1}^-1 mod m_i,
+ * the O(k^2) inverses only depend on the moduli and are computed once with exteuclid. The mixed radix digits are
+ * then evaluated with Horner's rule either modulo a target or as a big integer of 32-bit limbs, least
+ * significant first. Moduli must be below 2^62.
+ */
+class Garner{
+public:
+    explicit Garner(std::vector<int64_t> moduli) : moduli{std::move(moduli)}{
+        for(size_t i{1}; i < this->moduli.size(); ++i)
+            for(size_t j{0}; j < i; ++j)
+                inv.push_back(exteuclid(this->moduli[j] % this->moduli[i], this->moduli[i]));
+    }
+
+    int64_t reconstruct(const std::vector<int64_t>& residues, int64_t target) const{
+        auto v = mixed_radix(residues);
+        int64_t acc{0};
+        for(size_t i{v.size()}; i-- > 0;)
+            acc = static_cast<int64_t>((static_cast<__int128>(acc) * (moduli[i] % target) + v[i]) % target);
+        return acc;
+    }
+
+    std::vector<uint32_t> reconstruct(const std::vector<int64_t>& residues) const{
+        auto v = mixed_radix(residues);
+        std::vector<uint32_t> limbs;
+        for(size_t i{v.size()}; i-- > 0;){
+            unsigned __int128 carry{static_cast<uint64_t>(v[i])};
+            for(auto& limb : limbs){
+                carry += static_cast<unsigned __int128>(limb) * static_cast<uint64_t>(moduli[i]);
+                limb = static_cast<uint32_t>(carry);
+                carry >>= 32;
+            }
+            for(; carry; carry >>= 32)
+                limbs.push_back(static_cast<uint32_t>(carry));
+        }
+        return limbs;
+    }
+
+private:
+    std::vector<int64_t> mixed_radix(const std::vector<int64_t>& residues) const{
+        std::vector<int64_t> v(moduli.size());
+        const int64_t* row{inv.data()};
+        for(size_t i{0}; i < moduli.size(); ++i){
+            auto m = moduli[i];
+            auto x = reduce(residues[i], m);
+            for(size_t j{0}; j < i; ++j)
+                x = static_cast<int64_t>(static_cast<__int128>(reduce(x - v[j], m)) * row[j] % m);
+            v[i] = x;
+            row += i;
+        }
+        return v;
+    }
+
+    std::vector<int64_t> moduli;
+    std::vector<int64_t> inv; // Row i holds m_j^-1 mod m_i for j < i.
+};
+
+// Decimal representation of a Garner::reconstruct big integer.
+std::string to_string(std::vector<uint32_t> limbs){
+    std::string digits;
+    while(!limbs.empty()){
+        uint64_t rem{0};
+        for(size_t i{limbs.size()}; i-- > 0;){
+            auto cur = (rem << 32) | limbs[i];
+            limbs[i] = static_cast<uint32_t>(cur / 1'000'000'000);
+            rem = cur % 1'000'000'000;
+        }
+        while(!limbs.empty() && limbs.back() == 0)
+            limbs.pop_back();
+        for(int32_t d{0}; d < 9 && (rem || !limbs.empty()); ++d, rem /= 10)
+            digits.push_back(static_cast<char>('0' + rem % 10));
+    }
+    if(digits.empty())
+        digits = "0";
+    std::reverse(digits.begin(), digits.end());
+    return digits;
 }
 
 int main(){
-    int64_t T, a, n, b, m;
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
+
+    int64_t T;
     std::cin >> T;
-    while(T--){
-        std::cin >> a >> n >> b >> m;
-        auto [x, K] = chineseremainder(a,n,b,m);
+    std::vector<Query> queries(T);
+    for(auto& q : queries)
+        std::cin >> q.a >> q.n >> q.b >> q.m;
+    for(const auto& answer : chineseremainder_batch(queries)){
+        if(!answer){
+            std::cout << "no solution\n";
+            continue;
+        }
+        auto [x, K] = *answer;
         std::cout << x << " " << K << "\n";
     }
     return 0;
 }
-
@@ -7,50 +7,344 @@
 #include <vector>
 #include <cmath>
 #include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
 
-bool isHappyPrime(int32_t m){
-    std::vector<int32_t> prev;
-    std::string m_str;
-    int32_t c_int;
-    while(true){
-        prev.push_back(m);
-        m_str = std::to_string(m);
-        m = 0;
-        for(const auto& c : m_str){
-            c_int = c - '0';
-            m += (c_int * c_int);
-        }
-        if(m == 1){
-            return true;
+/*
+ * Primality is decided with a deterministic Miller-Rabin test. For every 64-bit m the witnesses
+ * {2, 325, 9375, 28178, 450775, 9780504, 1795265022} are known to expose all composites, so each query
+ * costs 7 modular exponentiations instead of O(m) trial divisions. Products are formed in 128 bits to
+ * avoid overflow. When many values are tested at once is_prime_batch() first rejects everything with a
+ * small prime factor, which removes roughly 85% of random inputs before any exponentiation.
+ * Usage:
+ *      bool isPrime(uint64_t m)
+ *
+ *      @param m        : Value to test.
+ *      return          : True if m is prime.
+ *
+ *      std::vector<uint8_t> is_prime_batch(const std::vector<uint64_t>& ms)
+ *
+ *      @param ms       : Values to test.
+ *      return          : result[i] != 0 iff ms[i] is prime.
+ *
+ *      bool isHappyPrime(uint64_t m)
+ *
+ *      @param m        : Value to test, primality is checked separately.
+ *      return          : True if m is a happy number.
+ *
+ *      RangeStats happy_primes_upto(uint64_t N, uint32_t threads, F emit)
+ *
+ *      @param N        : Upper bound of the range, inclusive.
+ *      @param threads  : Number of worker threads.
+ *      @param emit     : Called with every happy prime <= N in increasing order.
+ *      return          : Number of primes and happy primes <= N.
+ *
+ * Started as "happyprime N [threads]" the program runs the range engine instead and reports the number of happy
+ * primes <= N together with the sieving rate in primes/s.
+ */
+
+constexpr uint64_t kSmallPrimes[]{2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53};
+constexpr uint64_t kWitnesses[]{2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+
+uint64_t mulmod(uint64_t a, uint64_t b, uint64_t m){
+    return static_cast<uint64_t>(static_cast<unsigned __int128>(a) * b % m);
+}
+
+uint64_t powmod(uint64_t b, uint64_t e, uint64_t m){
+    uint64_t result{1};
+    b %= m;
+    while(e){
+        if(e & 1)
+            result = mulmod(result, b, m);
+        b = mulmod(b, b, m);
+        e >>= 1;
+    }
+    return result;
+}
+
+/*
+ * Writes m-1 = d*2^s with d odd. m is a strong probable prime to base a if a^d = 1 or a^(d*2^r) = -1 for
+ * some r < s. Only called for odd m without small factors.
+ */
+bool miller_rabin(uint64_t m){
+    auto d = m - 1;
+    auto s = __builtin_ctzll(d);
+    d >>= s;
+    for(const auto& w : kWitnesses){
+        auto a = w % m;
+        if(a == 0)
+            continue;
+        auto x = powmod(a, d, m);
+        if(x == 1 || x == m - 1)
+            continue;
+        bool composite{true};
+        for(int32_t r{1}; r < s && composite; ++r){
+            x = mulmod(x, x, m);
+            composite = x != m - 1;
         }
-        if(std::count(prev.begin(), prev.end(), m) != 0){
+        if(composite)
             return false;
+    }
+    return true;
+}
+
+/*
+ * Decides m by trial division with the small primes when possible, returns 1 for prime, 0 for composite
+ * and -1 when Miller-Rabin is needed.
+ */
+int32_t prefilter(uint64_t m){
+    if(m < 2)
+        return 0;
+    for(const auto& p : kSmallPrimes){
+        if(m % p == 0)
+            return m == p;
+    }
+    return m < 59 * 59 ? 1 : -1;
+}
+
+bool isPrime(uint64_t m){
+    auto known = prefilter(m);
+    return known >= 0 ? known : miller_rabin(m);
+}
+
+std::vector<uint8_t> is_prime_batch(const std::vector<uint64_t>& ms){
+    std::vector<uint8_t> result(ms.size(), 0);
+    std::vector<size_t> survivors;
+    for(size_t i{0}; i < ms.size(); ++i){
+        auto known = prefilter(ms[i]);
+        if(known >= 0)
+            result[i] = known;
+        else
+            survivors.push_back(i);
+    }
+    for(const auto& i : survivors)
+        result[i] = miller_rabin(ms[i]);
+    return result;
+}
+
+/*
+ * A value is happy if repeatedly replacing it by the sum of the squares of its digits reaches 1, every other value
+ * ends in the cycle through 4. One step takes any 64-bit value to at most 20*81 = 1620 and any value above 810 to
+ * something smaller, so after a couple of steps the answer is looked up in a table that is computed at compile
+ * time. The digit square sum works on 3 digits at a time through another table, no strings or allocations needed.
+ */
+struct HappyTables{
+    constexpr HappyTables() : square_sum{}, happy{}{
+        for(int32_t v{0}; v < 1000; ++v)
+            square_sum[v] = (v % 10) * (v % 10) + (v / 10 % 10) * (v / 10 % 10) + (v / 100) * (v / 100);
+        for(int32_t v{1}; v <= kLimit; ++v){
+            auto x = v;
+            while(x != 1 && x != 4)
+                x = square_sum[x % 1000] + square_sum[x / 1000];
+            happy[v] = x == 1;
         }
     }
 
+    static constexpr int32_t kLimit{810};
+    int32_t square_sum[1000];
+    bool happy[kLimit + 1];
+};
+
+constexpr HappyTables kHappy{};
+
+uint64_t digit_square_sum(uint64_t m){
+    uint64_t result{0};
+    while(m){
+        result += kHappy.square_sum[m % 1000];
+        m /= 1000;
+    }
+    return result;
 }
 
-bool isPrime(int32_t& m){
-    if(m == 1 || m == 2)
-        return false;
-    for(int32_t i{2}; i < m; ++i){
-        if(m % i == 0)
-            return false;
+bool isHappyPrime(uint64_t m){
+    while(m > HappyTables::kLimit)
+        m = digit_square_sum(m);
+    return kHappy.happy[m];
+}
+
+/*
+ * Range engine for all happy primes <= N. The range is cut into rounds of threads*kChunk numbers, every thread
+ * sieves its chunk in cache sized odd-only windows with the shared base primes up to sqrt(N) and filters the
+ * primes of each window for happiness. The filter works on the whole window at once: a branch free pass computes
+ * the digit square sums of all primes, a second pass folds the few sums above 810 and the table decides. After
+ * a round the per-thread results are emitted in increasing order, so memory stays O(threads*kChunk/log(N))
+ * regardless of N.
+ */
+struct RangeStats{
+    uint64_t primes;
+    uint64_t happy_primes;
+};
+
+constexpr uint64_t kWindow{1 << 16}; // Odd numbers per sieve window.
+constexpr uint64_t kChunk{64 * 2 * kWindow}; // Numbers per thread and round.
+
+std::vector<uint64_t> base_primes(uint64_t n){
+    std::vector<bool> composite(n+1, false);
+    std::vector<uint64_t> result;
+    for(uint64_t i{3}; i <= n; i += 2){
+        if(composite[i])
+            continue;
+        result.push_back(i);
+        for(uint64_t j{i*i}; j <= n; j += 2*i)
+            composite[j] = true;
     }
-    return true;
+    return result;
+}
+
+void happy_filter(std::vector<uint64_t>& primes, std::vector<uint64_t>& sums, std::vector<uint64_t>& out){
+    sums.resize(primes.size());
+    for(size_t i{0}; i < primes.size(); ++i){
+        auto m = primes[i];
+        uint64_t s{0};
+        for(int32_t d{0}; d < 7; ++d, m /= 1000) // 7 groups of 3 digits cover all 64-bit values.
+            s += kHappy.square_sum[m % 1000];
+        sums[i] = s;
+    }
+    for(size_t i{0}; i < primes.size(); ++i){
+        auto s = sums[i];
+        if(s > HappyTables::kLimit)
+            s = kHappy.square_sum[s % 1000] + kHappy.square_sum[s / 1000];
+        if(kHappy.happy[s])
+            out.push_back(primes[i]);
+    }
+}
+
+/*
+ * Sieves [from, to] and appends the happy primes found to out, from is odd. Returns the number of primes.
+ */
+uint64_t happy_primes_chunk(const std::vector<uint64_t>& base, uint64_t from, uint64_t to, std::vector<uint64_t>& out){
+    std::vector<uint8_t> window(kWindow);
+    std::vector<uint64_t> primes, sums;
+    uint64_t found{0};
+    for(uint64_t low{from}; low <= to; low += 2 * kWindow){
+        auto len = std::min(kWindow, (to - low) / 2 + 1);
+        auto high = low + 2 * (len - 1);
+        std::fill(window.begin(), window.begin() + len, 1);
+        for(const auto& p : base){
+            if(p * p > high)
+                break;
+            auto j = std::max(p * p, (low + p - 1) / p * p);
+            if(j % 2 == 0)
+                j += p;
+            for(; j <= high; j += 2 * p)
+                window[(j - low) / 2] = 0;
+        }
+        primes.clear();
+        for(uint64_t i{0}; i < len; ++i)
+            if(window[i] && low + 2 * i > 1)
+                primes.push_back(low + 2 * i);
+        found += primes.size();
+        happy_filter(primes, sums, out);
+    }
+    return found;
+}
+
+/*
+ * Calls emit(p) for every happy prime p <= N in increasing order, pass an emit that ignores its argument to
+ * only count them.
+ */
+template<typename F>
+RangeStats happy_primes_upto(uint64_t N, uint32_t threads, F&& emit){
+    RangeStats stats{N >= 2, 0}; // 2 is prime but not happy.
+    if(N < 3)
+        return stats;
+    threads = std::max(1u, threads);
+    auto root = static_cast<uint64_t>(std::sqrt(static_cast<double>(N)));
+    while(root * root > N) --root;
+    while((root + 1) * (root + 1) <= N) ++root;
+    auto base = base_primes(root);
+
+    std::vector<std::vector<uint64_t>> results(threads);
+    std::vector<uint64_t> found(threads);
+    for(uint64_t round{1}; round <= N; round += threads * kChunk){
+        std::vector<std::thread> workers;
+        for(uint32_t t{0}; t < threads; ++t){
+            auto from = round + t * kChunk;
+            if(from > N)
+                break;
+            auto to = std::min(N, from + kChunk - 1);
+            results[t].clear();
+            workers.emplace_back([&, t, from, to](){ found[t] = happy_primes_chunk(base, from, to, results[t]); });
+        }
+        for(size_t t{0}; t < workers.size(); ++t){
+            workers[t].join();
+            stats.primes += found[t];
+            stats.happy_primes += results[t].size();
+            for(const auto& p : results[t])
+                emit(p);
+        }
+    }
+    return stats;
 }
 
+#ifdef BENCHMARK
+/*
+ * Miller-Rabin throughput on random 64-bit values, build with -DBENCHMARK -O2.
+ */
 int main(){
-    int32_t P, K, m;
+    constexpr size_t kQueries{4'000'000};
+    std::vector<uint64_t> ms(kQueries);
+    uint64_t state{88172645463325252ULL};
+    for(auto& m : ms){
+        state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+        m = state | 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t single{0};
+    for(const auto& m : ms)
+        single += isPrime(m);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "isPrime        " << kQueries / elapsed.count() << " queries/s primes=" << single << "\n";
+
+    start = std::chrono::steady_clock::now();
+    auto batch = is_prime_batch(ms);
+    elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "is_prime_batch " << kQueries / elapsed.count() << " queries/s primes="
+              << std::count(batch.begin(), batch.end(), 1) << "\n";
+
+    auto cores = std::max(1u, std::thread::hardware_concurrency());
+    for(uint32_t t{1};; t = std::min(2 * t, cores)){
+        start = std::chrono::steady_clock::now();
+        auto stats = happy_primes_upto(1'000'000'000ULL, t, [](uint64_t){});
+        elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "range N=1e9 threads=" << t << " " << stats.primes / elapsed.count() << " primes/s happy="
+                  << stats.happy_primes << "\n";
+        if(t == cores)
+            break;
+    }
+}
+#else
+int main(int argc, char** argv){
+    if(argc > 1){
+        auto N = std::strtoull(argv[1], nullptr, 10);
+        auto threads = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : std::thread::hardware_concurrency();
+        auto start = std::chrono::steady_clock::now();
+        auto stats = happy_primes_upto(N, threads, [](uint64_t){});
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << stats.happy_primes << " happy primes, " << stats.primes << " primes, "
+                  << stats.primes / elapsed.count() << " primes/s\n";
+        return 0;
+    }
+
+    int32_t P;
     std::cin >> P;
-    while(P--){
-        std::cin >> K >> m;
+    std::vector<int32_t> K(P);
+    std::vector<uint64_t> m(P);
+    for(int32_t i{0}; i < P; ++i)
+        std::cin >> K[i] >> m[i];
+
+    auto prime = is_prime_batch(m);
+    for(int32_t i{0}; i < P; ++i){
         std::string result{"NO"};
-        if(isPrime(m)){
-            result = isHappyPrime(m) ? "YES" : "NO";
+        if(prime[i]){
+            result = isHappyPrime(m[i]) ? "YES" : "NO";
         }
 
-        std::cout << K << " " << m << " " << result << "\n";
+        std::cout << K[i] << " " << m[i] << " " << result << "\n";
     }
     return 0;
-}
\ No newline at end of file
+}
+#endif
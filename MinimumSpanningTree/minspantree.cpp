@@ -7,37 +7,8 @@
 #include <functional>
 #include <cmath>
 #include <numeric>
-
-// Couldn't get the #include to work so these are the unionfind.cpp functions
-// ----------------------- UNION FIND -------------------------
-uint32_t find_parent(uint32_t a, std::vector<uint32_t>& parents){
-    if(a == parents[a]){
-        return a;
-    }
-    return parents[a] = find_parent(parents[a], parents);
-}
-
-void union_sets(uint32_t a, uint32_t b, std::vector<uint32_t>& parents, std::vector<uint32_t>& size){
-    auto p_a = find_parent(a, parents);
-    auto p_b = find_parent(b, parents);
-
-    if(p_a != p_b){
-        if(size[p_a] > size[p_b]){
-            parents[p_b] = p_a;
-            size[p_a] += size[p_b];
-        }
-        else{
-            parents[p_a] = p_b;
-            size[p_b] += size[p_a];
-        }
-    }
-}
-
-bool same(uint32_t a, uint32_t b, std::vector<uint32_t>& parents){
-    return find_parent(a, parents) == find_parent(b, parents);
-}
-// -----------------------------------
-
+#include <algorithm>
+#include "../UnionFind/disjointset.h"
 
 /*
  * Finds a minimum spanning tree from a list of edges. This program runs with O(M*LogN) time complexity
@@ -67,19 +38,15 @@ struct Edge{
  */
 std::vector<std::pair<int32_t, int32_t>> mst(std::vector<Edge>& edges, int32_t n, int64_t& cost){
     std::sort(edges.begin(), edges.end());
-    // Initially, vertices make up a forest of single node trees. For the union finder, initialize all nodes
-    // as their own parent.
-    std::vector<uint32_t> parents(n);
-    std::vector<uint32_t> size(n, 1);
-    std::iota(parents.begin(), parents.end(), 0);
+    // Initially, vertices make up a forest of single node trees.
+    DisjointSet dsu(n);
     // Result vector
     std::vector<std::pair<int32_t, int32_t>> min_tree;
 
     // O(M*LogN) time complexity
     for(const auto& e : edges){
         // If the edge connects to different subtrees, join the trees.
-        if(!same(e.u, e.v, parents)){
-            union_sets(e.u, e.v, parents, size);
+        if(dsu.unite(e.u, e.v)){
             if(e.u < e.v)
                 min_tree.emplace_back(std::make_pair(e.u, e.v));
             else
@@ -89,11 +56,8 @@ std::vector<std::pair<int32_t, int32_t>> mst(std::vector<Edge>& edges, int32_t n
     }
 
     // Make sure the graph doesn't consist of multiple trees
-    // O(N) time complexity
-    for (int32_t i{1}; i < parents.size(); ++i) {
-        if (!same(parents[i], parents[i-1], parents)){
-            return std::vector<std::pair<int32_t, int32_t>>{};
-        }
+    if(dsu.count() > 1){
+        return std::vector<std::pair<int32_t, int32_t>>{};
     }
 
     return min_tree;
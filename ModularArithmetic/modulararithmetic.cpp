@@ -7,45 +7,152 @@
 #include <cmath>
 #include <algorithm>
 #include <numeric>
+#include <cstdint>
+#include <utility>
+#ifdef BENCHMARK
+#include <chrono>
+#endif
 /*
  * Implementation of a Modular operation class that handles modular arithmetic for +, -, / and *.
  * Usage:
- *      ModularOP(int n)
+ *      ModularOP<>(int n), ModularOP<N>()
  *
- *      @param x      : Modulus
+ *      @param x      : Modulus, either given at runtime or as the template argument N < 2^32. With a compile time
+ *                      modulus every reduction is by a constant, which the compiler turns into a multiply and
+ *                      shift (a mask for powers of two), and pow() and inverse() can be evaluated at compile time.
+ *                      dispatch() picks the compile time instance for the common moduli.
+ *
+ *      int[] div_batch(int[] xs, int[] ys)
+ *
+ *      @param xs     : Numerators, 0 <= x
+ *      @param ys     : Denominators, 0 <= y
+ *      return        : x/y mod n for every pair, -1 where y is not invertible
  *
  */
 
+template<int64_t N = 0>
 class ModularOP{
+    static_assert(N >= 0 && N < (int64_t{1} << 32), "compile time moduli must be below 2^32");
 public:
-    ModularOP() = default;
-    explicit ModularOP(int64_t n) : n{n}{}
+    static constexpr int64_t kModulus{N};
+
+    ModularOP() : n{N}{}
+    explicit ModularOP(int64_t n) : n{N != 0 ? N : n}{}
 
     // Compute the remainder of the operands independently to guarantee values smaller than 2n.
     int64_t add(int64_t& x, int64_t& y) const{
-        return (x%n + y%n)%n;
+        return static_cast<int64_t>((static_cast<__int128>(x%modulus()) + y%modulus())%modulus());
     }
 
     int64_t sub(int64_t& x, int64_t& y) const{
         auto a = x - y;
         if(a < 0)
-            a += n;
+            a += modulus();
         return a;
     }
 
     // Uses the extended euclidean algorithm to find the modular inverse to solve x*y^-1 instead of x/y.
     int64_t div(int64_t& x, int64_t& y) const{
-        if(std::gcd(y, n) != 1){ // Need to be relative prime
+        if(std::gcd(y, modulus()) != 1){ // Need to be relative prime
             return -1;
         }
 
-        auto inv = exteuclid(y,n);
-        return (x%n * inv%n)%n;
+        auto inv = exteuclid(y, modulus());
+        return mul(x, inv);
+    }
+
+    /*
+     * Montgomery's trick: with prefix products p_i = y_0*...*y_i the single inverse of p_{k-1} gives every y_i^-1
+     * walking backwards, y_i^-1 = p_{k-1}^-1 * y_{k-1} * ... * y_{i+1} * p_{i-1}. That is one extended euclid call
+     * and 3(k-1) multiplications instead of k gcd and k extended euclid calls. If the product shares a factor with
+     * n some denominator is not invertible, those are found with a gcd each, answered with -1 and the trick is
+     * applied to the rest.
+     */
+    std::vector<int64_t> div_batch(const std::vector<int64_t>& xs, const std::vector<int64_t>& ys) const{
+        std::vector<int64_t> result(xs.size(), -1);
+        std::vector<size_t> invertible;
+        for(size_t i{0}; i < ys.size(); ++i)
+            if(ys[i] % modulus() != 0 || modulus() == 1)
+                invertible.push_back(i);
+        if(invertible.empty())
+            return result;
+
+        std::vector<int64_t> prefix(invertible.size());
+        auto product_of = [&](){
+            int64_t p{1 % modulus()};
+            for(size_t k{0}; k < invertible.size(); ++k){
+                auto y = ys[invertible[k]];
+                prefix[k] = p = mul(p, y);
+            }
+            return p;
+        };
+        auto total = product_of();
+        if(std::gcd(total, modulus()) != 1){
+            invertible.erase(std::remove_if(invertible.begin(), invertible.end(), [&](size_t i){
+                return std::gcd(ys[i] % modulus(), modulus()) != 1;
+            }), invertible.end());
+            if(invertible.empty())
+                return result;
+            prefix.resize(invertible.size());
+            total = product_of();
+        }
+
+        auto inv = exteuclid(total, modulus());
+        for(size_t k{invertible.size()}; k-- > 0;){
+            auto i = invertible[k];
+            auto y = ys[i] % modulus();
+            auto inv_y = k ? mul(inv, prefix[k-1]) : inv;
+            auto x = xs[i];
+            result[i] = mul(x, inv_y);
+            inv = mul(inv, y);
+        }
+        return result;
+    }
+
+    // The product of the remainders is formed in 128 bits so any n below 2^63 is safe. A compile time modulus is
+    // below 2^32, there the product fits in 64 bits and the reduction by the constant becomes a multiply and shift.
+    int64_t mul(const int64_t& x, const int64_t& y) const{
+        if constexpr(N != 0)
+            return static_cast<int64_t>(static_cast<uint64_t>(x % N) * static_cast<uint64_t>(y % N) % N);
+        else
+            return static_cast<int64_t>(static_cast<__int128>(x%n) * (y%n) % n);
+    }
+
+    int64_t modulus() const{
+        if constexpr(N != 0)
+            return N;
+        else
+            return n;
     }
 
-    // Compute the remainder of the operands to reduce risk of overflow but not yet as good as sub/add (2n).
-    int64_t mul(int64_t& x, int64_t& y) const{
-        return (x%n * y%n)%n;
+    // b^e mod N, usable in constant expressions.
+    static constexpr int64_t pow(int64_t b, uint64_t e){
+        static_assert(N != 0, "pow needs a compile time modulus");
+        uint64_t result{1 % N}, base{static_cast<uint64_t>(b % N)};
+        for(; e; e >>= 1){
+            if(e & 1)
+                result = result * base % N;
+            base = base * base % N;
+        }
+        return static_cast<int64_t>(result);
+    }
+
+    // y^-1 mod N, or -1 if gcd(y, N) != 1. Usable in constant expressions.
+    static constexpr int64_t inverse(int64_t y){
+        static_assert(N != 0, "inverse needs a compile time modulus");
+        int64_t r0{N}, r1{y % N}, t0{0}, t1{1};
+        while(r1 != 0){
+            auto q = r0 / r1;
+            auto r = r0 - q * r1;
+            r0 = r1;
+            r1 = r;
+            auto t = t0 - q * t1;
+            t0 = t1;
+            t1 = t;
+        }
+        if(r0 != 1)
+            return N == 1 ? 0 : -1;
+        return t0 < 0 ? t0 + N : t0;
     }
 
     int64_t n;
@@ -70,36 +177,626 @@ private:
     }
 };
 
+/*
+ * Montgomery multiplication for a fixed odd modulus n < 2^63. With R = 2^64, reduce(t) = t*R^-1 mod n needs two
+ * multiplications and a shift instead of a 128-bit division. For independent products it is applied twice,
+ * reduce(reduce(x*y) * R^2) = x*y mod n, which still avoids the division. Operands must be smaller than n.
+ */
+class Montgomery{
+public:
+    explicit Montgomery(uint64_t n) : n{n}, neg_inv{n}{
+        for(int32_t i{0}; i < 5; ++i) // Newton iteration, every step doubles the number of correct bits.
+            neg_inv *= 2 - n * neg_inv;
+        neg_inv = 0 - neg_inv;
+        auto r = static_cast<unsigned __int128>((0 - n) % n); // 2^64 mod n
+        r2 = static_cast<uint64_t>(r * r % n);
+    }
+
+    uint64_t reduce(unsigned __int128 t) const{
+        uint64_t m{static_cast<uint64_t>(t) * neg_inv};
+        auto u = static_cast<uint64_t>((t + static_cast<unsigned __int128>(m) * n) >> 64);
+        return u >= n ? u - n : u;
+    }
+
+    uint64_t mul(uint64_t x, uint64_t y) const{
+        return reduce(static_cast<unsigned __int128>(reduce(static_cast<unsigned __int128>(x) * y)) * r2);
+    }
+
+    uint64_t n, neg_inv, r2;
+};
+
+/*
+ * The same with R = 2^32 for odd n < 2^31. Every intermediate fits in 64 bits and the correction is branch free,
+ * which makes it the cheapest product backend of ModularBatch.
+ */
+struct Montgomery32{
+    explicit Montgomery32(uint32_t n) : n{n}, neg_inv{n}{
+        for(int32_t i{0}; i < 4; ++i)
+            neg_inv *= 2 - n * neg_inv;
+        neg_inv = 0 - neg_inv;
+        r2 = static_cast<uint32_t>((static_cast<unsigned __int128>(1) << 64) % n);
+    }
+
+    uint32_t reduce(uint64_t t) const{
+        uint32_t m{static_cast<uint32_t>(t) * neg_inv};
+        auto u = static_cast<uint32_t>((t + static_cast<uint64_t>(m) * n) >> 32);
+        return u - (u >= n ? n : 0);
+    }
+
+    uint32_t mul(uint32_t x, uint32_t y) const{
+        return reduce(static_cast<uint64_t>(reduce(static_cast<uint64_t>(x) * y)) * r2);
+    }
+
+    uint32_t n, neg_inv, r2;
+};
+
+// Operator to candidate index in ModularBatch, indexed loads keep its loop free of branches. Bit 2 marks a division.
+struct OperatorSlots{
+    constexpr OperatorSlots() : of{}{
+        of[static_cast<uint8_t>('+')] = 1;
+        of[static_cast<uint8_t>('-')] = 2;
+        of[static_cast<uint8_t>('*')] = 3;
+        of[static_cast<uint8_t>('/')] = 4;
+    }
+    uint8_t of[256];
+};
+
+constexpr OperatorSlots kSlot{};
+
+/*
+ * Evaluates a block of t operations x op y under one modulus. The operands are kept in columns and the block is
+ * processed in input order by one loop without data dependent branches: the sum, difference and product of every
+ * pair are all formed and the operator selects the result, so random operator sequences cost no mispredictions.
+ * The product uses Montgomery32 when n is odd and below 2^31, Montgomery when n is odd and below 2^63 and a mask
+ * for powers of two. Other even moduli fall back to ModularOP one operation at a time, since forming every product
+ * would then cost a division each. Divisions are gathered afterwards and share one modular inversion through
+ * ModularOP::div_batch(). When the whole block has one operator other than / it is evaluated column by column
+ * with add(), sub() or mul() instead, which can also be called directly. add() and sub() are branch free and walk
+ * kLanes elements at a time with a constant trip count, which GCC vectorizes already at -O2.
+ * Usage:
+ *      ModularBatch(int n).evaluate(int[] xs, char[] ops, int[] ys)
+ *
+ *      @param n        : Modulus of the block.
+ *      @param xs, ys   : Operands, 0 <= x, y.
+ *      @param ops      : One of + - * / per operation.
+ *      return          : Result of every operation, -1 for a division by a non-invertible value.
+ */
+template<typename Op = ModularOP<>>
+class ModularBatch{
+public:
+    explicit ModularBatch(int64_t n) : op{n}, n{static_cast<uint64_t>(op.modulus())}{}
+
+    std::vector<int64_t> evaluate(const std::vector<int64_t>& xs, const std::vector<char>& ops,
+                                  const std::vector<int64_t>& ys) const{
+        auto t = ops.size();
+        std::vector<int64_t> result(t);
+        auto first = t ? ops[0] : '/';
+        if(first != '/' && std::all_of(ops.begin(), ops.end(), [first](char c){ return c == first; })){ // One column.
+            std::vector<uint64_t> a(t), b(t);
+            for(size_t i{0}; i < t; ++i){
+                a[i] = reduce(xs[i]);
+                b[i] = reduce(ys[i]);
+            }
+            auto* r = reinterpret_cast<uint64_t*>(result.data());
+            if(first == '+')
+                add(a.data(), b.data(), r, t);
+            else if(first == '-')
+                sub(a.data(), b.data(), r, t);
+            else if(first == '*')
+                mul(a.data(), b.data(), r, t);
+            return result;
+        }
+
+        if(!cheap_product()){ // Forming every product would cost a division per operation.
+            for(size_t i{0}; i < t; ++i){
+                auto a = reduce(xs[i]), b = reduce(ys[i]);
+                auto c = ops[i];
+                if(c == '*'){
+                    auto x = static_cast<int64_t>(a), y = static_cast<int64_t>(b);
+                    result[i] = op.mul(x, y);
+                }else{
+                    result[i] = static_cast<int64_t>(c == '+' ? add_mod(a, b, n) : c == '-' ? sub_mod(a, b, n) : 0);
+                }
+            }
+            divide(xs, ops, ys, result);
+            return result;
+        }
+
+        size_t divisions{0};
+        with_product([&](auto product){
+            for(size_t i{0}; i < t; ++i){
+                auto a = static_cast<uint64_t>(xs[i]), b = static_cast<uint64_t>(ys[i]);
+                if(a >= n || b >= n){ // Negative operands wrap around and end up here as well.
+                    a = reduce(xs[i]);
+                    b = reduce(ys[i]);
+                }
+                auto s = add_mod(a, b, n);
+                auto d = sub_mod(a, b, n);
+                auto p = product(a, b);
+                const uint64_t candidates[4]{0, s, d, p};
+                auto slot = kSlot.of[static_cast<uint8_t>(ops[i])];
+                result[i] = static_cast<int64_t>(candidates[slot & 3]);
+                divisions += slot >> 2;
+            }
+        });
+        if(divisions)
+            divide(xs, ops, ys, result);
+        return result;
+    }
+
+    // The columns must not overlap, the operands must be below n.
+    void add(const uint64_t* a, const uint64_t* b, uint64_t* r, size_t count) const{
+        auto m = n;
+        columns(a, b, r, count, [m](uint64_t x, uint64_t y){ return add_mod(x, y, m); });
+    }
+
+    void sub(const uint64_t* a, const uint64_t* b, uint64_t* r, size_t count) const{
+        auto m = n;
+        columns(a, b, r, count, [m](uint64_t x, uint64_t y){ return sub_mod(x, y, m); });
+    }
+
+    void mul(const uint64_t* a, const uint64_t* b, uint64_t* r, size_t count) const{
+        with_product([&](auto product){
+            columns(a, b, r, count, product);
+        });
+    }
+
+private:
+    static constexpr size_t kLanes{8};
+
+    /*
+     * x + y mod n and x - y mod n for x, y < n <= 2^63 without a compare: the sign of the overflowing result is
+     * spread into a mask that selects whether n is added back.
+     */
+    static uint64_t add_mod(uint64_t x, uint64_t y, uint64_t n){
+        auto s = x + y - n;
+        return s + (n & static_cast<uint64_t>(static_cast<int64_t>(s) >> 63));
+    }
+
+    static uint64_t sub_mod(uint64_t x, uint64_t y, uint64_t n){
+        auto d = x - y;
+        return d + (n & static_cast<uint64_t>(static_cast<int64_t>(d) >> 63));
+    }
+
+    // r[k] = f(a[k], b[k]). The inner loop of kLanes iterations over non aliasing columns is what -O2 vectorizes.
+    template<typename F>
+    static void columns(const uint64_t* __restrict a, const uint64_t* __restrict b, uint64_t* __restrict r,
+                        size_t count, F f){
+        size_t k{0};
+        for(; k + kLanes <= count; k += kLanes)
+            for(size_t j{0}; j < kLanes; ++j)
+                r[k + j] = f(a[k + j], b[k + j]);
+        for(; k < count; ++k)
+            r[k] = f(a[k], b[k]);
+    }
+
+    // Gathers all divisions of the block and inverts their denominators together with ModularOP::div_batch.
+    void divide(const std::vector<int64_t>& xs, const std::vector<char>& ops, const std::vector<int64_t>& ys,
+                std::vector<int64_t>& result) const{
+        std::vector<size_t> index;
+        std::vector<int64_t> dx, dy;
+        for(size_t i{0}; i < ops.size(); ++i){
+            if(ops[i] == '/'){
+                index.push_back(i);
+                dx.push_back(static_cast<int64_t>(reduce(xs[i])));
+                dy.push_back(static_cast<int64_t>(reduce(ys[i])));
+            }
+        }
+        auto quotients = op.div_batch(dx, dy);
+        for(size_t k{0}; k < index.size(); ++k)
+            result[index[k]] = quotients[k];
+    }
+
+    bool cheap_product() const{
+        return Op::kModulus != 0 || n % 2 == 1 || (n & (n - 1)) == 0;
+    }
+
+    // Calls f with the fastest product backend for n, the choice is made once per block and not per operation.
+    template<typename F>
+    void with_product(F&& f) const{
+        if constexpr(Op::kModulus != 0){
+            f([](uint64_t x, uint64_t y){ return x * y % Op::kModulus; });
+            return;
+        }
+        if(n % 2 == 1 && n > 1 && n < (uint64_t{1} << 31)){
+            Montgomery32 mont{static_cast<uint32_t>(n)};
+            f([mont](uint64_t x, uint64_t y) -> uint64_t{
+                return mont.mul(static_cast<uint32_t>(x), static_cast<uint32_t>(y));
+            });
+        } else if(n % 2 == 1 && n > 1){
+            Montgomery mont{n};
+            f([mont](uint64_t x, uint64_t y){ return mont.mul(x, y); });
+        } else if((n & (n - 1)) == 0){
+            auto mask = n - 1;
+            f([mask](uint64_t x, uint64_t y){ return x * y & mask; });
+        } else{
+            auto mod = op;
+            f([mod](uint64_t x, uint64_t y){
+                auto a = static_cast<int64_t>(x), b = static_cast<int64_t>(y);
+                return static_cast<uint64_t>(mod.mul(a, b));
+            });
+        }
+    }
+
+    // Inputs are normally already below n, only then is the division skipped.
+    uint64_t reduce(int64_t x) const{
+        auto m = op.modulus();
+        return static_cast<uint64_t>(x >= 0 && static_cast<uint64_t>(x) < n ? x : (x % m + m) % m);
+    }
+
+    Op op;
+    uint64_t n;
+};
+
+/*
+ * Square matrices over Z/nZ stored row major in one buffer. A product entry is a dot product of a row of the left
+ * factor and a row of the transposed right factor, both contiguous. The terms are summed unreduced in 128 bits and
+ * only the sum is reduced, one division per entry instead of one per term. With n below 2^32 a term is below 2^64
+ * and any k fits, for larger n the terms are reduced as they are added once k products could overflow the sum.
+ * Rows and columns are walked in kTile x kTile tiles so a tile of each factor stays in cache while it is reused.
+ * Usage:
+ *      ModularMatrix(int k, ModularOP op), ModularMatrix::identity(int k, ModularOP op)
+ *
+ *      ModularMatrix pow(int e)
+ *
+ *      @param e        : Exponent, the power is formed with O(log e) products of O(k^3).
+ *      return          : This matrix to the power e.
+ */
+template<typename Op = ModularOP<>>
+class ModularMatrix{
+public:
+    ModularMatrix(size_t k, Op op) : k{k}, op{op}, cells(k * k, 0){}
+
+    static ModularMatrix identity(size_t k, Op op){
+        ModularMatrix m{k, op};
+        for(size_t i{0}; i < k; ++i)
+            m.at(i, i) = 1 % static_cast<uint64_t>(op.modulus());
+        return m;
+    }
+
+    uint64_t& at(size_t i, size_t j){ return cells[i * k + j]; }
+    uint64_t at(size_t i, size_t j) const{ return cells[i * k + j]; }
+    size_t size() const{ return k; }
+
+    ModularMatrix operator*(const ModularMatrix& other) const{
+        std::vector<uint64_t> transposed(k * k);
+        for(size_t i{0}; i < k; ++i)
+            for(size_t j{0}; j < k; ++j)
+                transposed[j * k + i] = other.cells[i * k + j];
+
+        ModularMatrix result{k, op};
+        auto n = static_cast<uint64_t>(op.modulus());
+        bool lazy{fits_unreduced(n, k)};
+        for(size_t ii{0}; ii < k; ii += kTile)
+            for(size_t jj{0}; jj < k; jj += kTile)
+                for(size_t i{ii}; i < std::min(ii + kTile, k); ++i){
+                    const uint64_t* row{&cells[i * k]};
+                    for(size_t j{jj}; j < std::min(jj + kTile, k); ++j)
+                        result.cells[i * k + j] = dot(row, &transposed[j * k], k, n, lazy);
+                }
+        return result;
+    }
+
+    ModularMatrix pow(uint64_t e) const{
+        auto result = identity(k, op);
+        auto base = *this;
+        for(; e; e >>= 1){
+            if(e & 1)
+                result = result * base;
+            if(e > 1)
+                base = base * base;
+        }
+        return result;
+    }
+
+    // True if count products of values below n can be summed in 128 bits without overflow.
+    static bool fits_unreduced(uint64_t n, size_t count){
+        auto term = static_cast<unsigned __int128>(n - 1) * (n - 1);
+        return term == 0 || count <= ~static_cast<unsigned __int128>(0) / term;
+    }
+
+    static uint64_t dot(const uint64_t* a, const uint64_t* b, size_t count, uint64_t n, bool lazy){
+        unsigned __int128 sum{0};
+        if(lazy){
+            for(size_t t{0}; t < count; ++t)
+                sum += static_cast<unsigned __int128>(a[t]) * b[t];
+        }else{
+            for(size_t t{0}; t < count; ++t)
+                sum += static_cast<unsigned __int128>(a[t]) * b[t] % n;
+        }
+        return static_cast<uint64_t>(sum % n);
+    }
+
+private:
+    static constexpr size_t kTile{32};
+
+    size_t k;
+    Op op;
+    std::vector<uint64_t> cells;
+};
+
+/*
+ * Linear recurrence a_i = c_1*a_{i-1} + ... + c_k*a_{i-k} mod n given a_0, ..., a_{k-1}. nth_matrix() raises the
+ * k x k companion matrix to the power N in O(k^3 log N). nth() uses Kitamasa's method instead: a_N is the
+ * combination sum r_j*a_j where r(x) = x^N mod f(x) and f(x) = x^k - c_1*x^{k-1} - ... - c_k is the characteristic
+ * polynomial, x^N mod f is found by repeated squaring with O(k^2) products and reductions modulo f, in total
+ * O(k^2 log N). Both sum their products lazily the same way as ModularMatrix.
+ * Usage:
+ *      LinearRecurrence(int[] c, int[] a, ModularOP op)
+ *
+ *      @param c        : Coefficients c_1, ..., c_k.
+ *      @param a        : Initial terms a_0, ..., a_{k-1}.
+ *      @param op       : Modulus n, below 2^63.
+ *
+ *      int nth(int N), int nth_matrix(int N)
+ *
+ *      @param N        : Index, 0 <= N < 2^64.
+ *      return          : a_N mod n.
+ */
+template<typename Op = ModularOP<>>
+class LinearRecurrence{
+public:
+    LinearRecurrence(const std::vector<int64_t>& c, const std::vector<int64_t>& a, Op op) : op{op}{
+        n = static_cast<uint64_t>(op.modulus());
+        auto residue = [&](int64_t x){
+            x %= op.modulus();
+            return static_cast<uint64_t>(x < 0 ? x + op.modulus() : x);
+        };
+        for(const auto& x : c)
+            coefficients.push_back(residue(x));
+        for(const auto& x : a)
+            initial.push_back(residue(x));
+        lazy = ModularMatrix<Op>::fits_unreduced(n, 2 * coefficients.size());
+    }
+
+    int64_t nth_matrix(uint64_t N) const{
+        auto k = coefficients.size();
+        ModularMatrix<Op> companion{k, op};
+        for(size_t j{0}; j < k; ++j)
+            companion.at(0, j) = coefficients[j];
+        for(size_t i{1}; i < k; ++i)
+            companion.at(i, i - 1) = 1 % n;
+
+        // The state (a_{i+k-1}, ..., a_i) is advanced by the companion matrix, a_N is the last entry at i = N.
+        auto power = companion.pow(N);
+        std::vector<uint64_t> state(initial.rbegin(), initial.rend());
+        return static_cast<int64_t>(ModularMatrix<Op>::dot(&power.at(k - 1, 0), state.data(), k, n, lazy));
+    }
+
+    int64_t nth(uint64_t N) const{
+        auto k = coefficients.size();
+        if(N < k)
+            return static_cast<int64_t>(initial[N]);
+
+        std::vector<uint64_t> r(k, 0); // x^0 mod f
+        r[0] = 1 % n;
+        for(int32_t bit{63 - __builtin_clzll(N)}; bit >= 0; --bit){
+            r = multiply(r, r);
+            if((N >> bit) & 1)
+                r = shift(r);
+        }
+        return static_cast<int64_t>(ModularMatrix<Op>::dot(r.data(), initial.data(), k, n, lazy));
+    }
+
+private:
+    // p(x) * q(x) mod f(x) for p and q of degree below k.
+    std::vector<uint64_t> multiply(const std::vector<uint64_t>& p, const std::vector<uint64_t>& q) const{
+        auto k = coefficients.size();
+        std::vector<unsigned __int128> acc(2 * k - 1, 0);
+        for(size_t i{0}; i < k; ++i){
+            if(p[i] == 0)
+                continue;
+            for(size_t j{0}; j < k; ++j)
+                add(acc[i + j], p[i], q[j]);
+        }
+        // x^d = c_1*x^{d-1} + ... + c_k*x^{d-k} for d >= k, highest degree first.
+        for(size_t d{2 * k - 1}; d-- > k;){
+            auto top = static_cast<uint64_t>(acc[d] % n);
+            if(top == 0)
+                continue;
+            for(size_t j{0}; j < k; ++j)
+                add(acc[d - 1 - j], top, coefficients[j]);
+        }
+        std::vector<uint64_t> result(k);
+        for(size_t i{0}; i < k; ++i)
+            result[i] = static_cast<uint64_t>(acc[i] % n);
+        return result;
+    }
+
+    // x * p(x) mod f(x).
+    std::vector<uint64_t> shift(const std::vector<uint64_t>& p) const{
+        auto k = coefficients.size();
+        auto top = p[k - 1];
+        std::vector<uint64_t> result(k);
+        for(size_t i{k}; i-- > 0;){
+            auto carried = static_cast<unsigned __int128>(top) * coefficients[k - 1 - i] + (i ? p[i - 1] : 0);
+            result[i] = static_cast<uint64_t>(carried % n);
+        }
+        return result;
+    }
+
+    // Every accumulator receives at most 2k terms, lazy tells if they fit unreduced.
+    void add(unsigned __int128& acc, uint64_t x, uint64_t y) const{
+        auto term = static_cast<unsigned __int128>(x) * y;
+        acc += lazy ? term : term % n;
+    }
+
+    Op op;
+    uint64_t n;
+    bool lazy;
+    std::vector<uint64_t> coefficients, initial;
+};
+
+/*
+ * Calls f with a ModularOP<n> when n is one of the common moduli known at compile time, 10^9+7, 998244353 or a
+ * power of two up to 2^31, and with the runtime ModularOP<> otherwise.
+ */
+template<typename F, size_t... K>
+bool dispatch_power_of_two(int64_t n, F& f, std::index_sequence<K...>){
+    return ((n == (int64_t{1} << K) ? (f(ModularOP<(int64_t{1} << K)>{}), true) : false) || ...);
+}
+
+template<typename F>
+void dispatch(int64_t n, F&& f){
+    if(n == 1'000'000'007)
+        f(ModularOP<1'000'000'007>{});
+    else if(n == 998'244'353)
+        f(ModularOP<998'244'353>{});
+    else if(!dispatch_power_of_two(n, f, std::make_index_sequence<32>{}))
+        f(ModularOP<>{n});
+}
+
+#ifdef BENCHMARK
+/*
+ * Throughput of ModularOP one operation at a time, with the modulus given at runtime and as chosen by dispatch(),
+ * against ModularBatch on blocks of kBlock operations, of single divisions against div_batch(), and of
+ * LinearRecurrence::nth() against nth_matrix() at N = 10^18, build with -DBENCHMARK -O2.
+ */
+int main(){
+    constexpr size_t kOps{4'000'000}, kBlock{1000};
+    for(int64_t n : {int64_t{1'000'000'007}, int64_t{998'244'353}, int64_t{1'000'000'000'000'000'009},
+                     int64_t{1} << 40}){
+        std::vector<int64_t> xs(kOps), ys(kOps);
+        std::vector<char> ops(kOps);
+        uint64_t state{88172645463325252ULL};
+        for(size_t i{0}; i < kOps; ++i){
+            state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+            xs[i] = static_cast<int64_t>(state % n);
+            ys[i] = static_cast<int64_t>((state >> 7) % n);
+            ops[i] = "+-**"[state >> 62];
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        ModularOP<> mod{n};
+        int64_t checksum{0};
+        for(size_t i{0}; i < kOps; ++i)
+            checksum += ops[i] == '+' ? mod.add(xs[i], ys[i]) : ops[i] == '-' ? mod.sub(xs[i], ys[i]) : mod.mul(xs[i], ys[i]);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "n=" << n << " ModularOP   " << kOps / elapsed.count() << " ops/s checksum=" << checksum << "\n";
+
+        dispatch(n, [&](auto fixed){
+            auto start = std::chrono::steady_clock::now();
+            int64_t checksum{0};
+            for(size_t i{0}; i < kOps; ++i)
+                checksum += ops[i] == '+' ? fixed.add(xs[i], ys[i]) : ops[i] == '-' ? fixed.sub(xs[i], ys[i]) : fixed.mul(xs[i], ys[i]);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << "n=" << n << " ModularOP<" << decltype(fixed)::kModulus << "> " << kOps / elapsed.count()
+                      << " ops/s checksum=" << checksum << "\n";
+        });
+
+        std::vector<std::vector<int64_t>> bx, by;
+        std::vector<std::vector<char>> bo;
+        for(size_t from{0}; from < kOps; from += kBlock){
+            bx.emplace_back(xs.begin() + from, xs.begin() + from + kBlock);
+            by.emplace_back(ys.begin() + from, ys.begin() + from + kBlock);
+            bo.emplace_back(ops.begin() + from, ops.begin() + from + kBlock);
+        }
+        start = std::chrono::steady_clock::now();
+        ModularBatch<> batch{n};
+        checksum = 0;
+        for(size_t k{0}; k < bx.size(); ++k)
+            for(const auto& r : batch.evaluate(bx[k], bo[k], by[k]))
+                checksum += r;
+        elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "n=" << n << " ModularBatch " << kOps / elapsed.count() << " ops/s checksum=" << checksum << "\n";
+
+        for(char c : {'+', '-', '*'}){ // Blocks with one operator take the column path.
+            std::vector<char> same(kBlock, c);
+            start = std::chrono::steady_clock::now();
+            checksum = 0;
+            for(size_t i{0}; i < kOps; ++i)
+                checksum += c == '+' ? mod.add(xs[i], ys[i]) : c == '-' ? mod.sub(xs[i], ys[i]) : mod.mul(xs[i], ys[i]);
+            elapsed = std::chrono::steady_clock::now() - start;
+            auto single = elapsed.count();
+            start = std::chrono::steady_clock::now();
+            auto columns = checksum;
+            checksum = 0;
+            for(size_t k{0}; k < bx.size(); ++k)
+                for(const auto& r : batch.evaluate(bx[k], same, by[k]))
+                    checksum += r;
+            elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << "n=" << n << " column " << c << "   " << kOps / elapsed.count() << " ops/s, "
+                      << single / elapsed.count() << "x ModularOP" << (checksum == columns ? "" : " MISMATCH") << "\n";
+        }
+
+        start = std::chrono::steady_clock::now();
+        checksum = 0;
+        for(size_t i{0}; i < kOps; ++i)
+            checksum += mod.div(xs[i], ys[i]);
+        elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "n=" << n << " div       " << kOps / elapsed.count() << " ops/s checksum=" << checksum << "\n";
+
+        start = std::chrono::steady_clock::now();
+        checksum = 0;
+        for(size_t k{0}; k < bx.size(); ++k)
+            for(const auto& r : mod.div_batch(bx[k], by[k]))
+                checksum += r;
+        elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "n=" << n << " div_batch " << kOps / elapsed.count() << " ops/s checksum=" << checksum << "\n";
+    }
+
+    // Mixed blocks under an even modulus above 2^62 take the fallback of ModularBatch, checked against 128 bits.
+    {
+        constexpr int64_t n{9'223'372'036'854'775'806};
+        std::vector<int64_t> xs{7'429'929'076'450'810'510}, ys{4'616'777'597'026'288'506};
+        std::vector<char> ops{'+'};
+        uint64_t state{88172645463325252ULL};
+        for(size_t i{0}; i < 999; ++i){
+            state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+            xs.push_back(static_cast<int64_t>(state >> 1));
+            ys.push_back(static_cast<int64_t>((state * 0x9E3779B97F4A7C15ULL) >> 1));
+            ops.push_back("+-*"[state % 3]);
+        }
+        auto result = ModularBatch<>{n}.evaluate(xs, ops, ys);
+        size_t wrong{0};
+        for(size_t i{0}; i < ops.size(); ++i){
+            __int128 x{xs[i] % n}, y{ys[i] % n};
+            auto expected = ops[i] == '+' ? (x + y) % n : ops[i] == '-' ? (x - y + n) % n : x * y % n;
+            wrong += result[i] != static_cast<int64_t>(expected);
+        }
+        std::cout << "n=" << n << " mixed block " << (wrong ? "MISMATCH" : "ok") << " " << xs[0] << " + " << ys[0]
+                  << " = " << result[0] << "\n";
+    }
+
+    constexpr uint64_t kIndex{1'000'000'000'000'000'000};
+    for(int64_t n : {int64_t{1'000'000'007}, int64_t{1'000'000'000'000'000'009}}){
+        for(size_t k : {size_t{16}, size_t{64}, size_t{200}}){
+            std::vector<int64_t> c(k), a(k);
+            uint64_t state{88172645463325252ULL};
+            for(size_t i{0}; i < k; ++i){
+                state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+                c[i] = static_cast<int64_t>(state % n);
+                a[i] = static_cast<int64_t>((state >> 7) % n);
+            }
+            LinearRecurrence<> recurrence{c, a, ModularOP<>{n}};
+            auto start = std::chrono::steady_clock::now();
+            auto polynomial = recurrence.nth(kIndex);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << "n=" << n << " k=" << k << " kitamasa " << elapsed.count() << " s a_N=" << polynomial << "\n";
+
+            start = std::chrono::steady_clock::now();
+            auto matrix = recurrence.nth_matrix(kIndex);
+            elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << "n=" << n << " k=" << k << " matrix   " << elapsed.count() << " s a_N=" << matrix << "\n";
+        }
+    }
+}
+#else
 int main(){
     int32_t t;
-    int64_t n,x,y;
-    char op;
+    int64_t n;
     while(std::cin >> n >> t){
         if(n == 0 && t == 0)
             break;
-        ModularOP mod{n};
-        for(int32_t i{0}; i < t; ++i){
-            std::cin >> x >> op >> y;
-            int64_t res{0};
-            switch(op){
-                case '+':
-                    res = mod.add(x,y);
-                    break;
-                case '-':
-                    res = mod.sub(x,y);
-                    break;
-                case '/':
-                    res = mod.div(x,y);
-                    break;
-                case '*':
-                    res = mod.mul(x,y);
-                    break;
-                default:
-                    break;
-            }
-            std::cout << res << "\n";
-        }
+        std::vector<int64_t> xs(t), ys(t);
+        std::vector<char> ops(t);
+        for(int32_t i{0}; i < t; ++i)
+            std::cin >> xs[i] >> ops[i] >> ys[i];
+        dispatch(n, [&](auto mod){
+            for(const auto& res : ModularBatch<decltype(mod)>{n}.evaluate(xs, ops, ys))
+                std::cout << res << "\n";
+        });
     }
     return 0;
 }
-
+#endif
@@ -1,33 +1,144 @@
 
-
 #include <vector>
 #include <iostream>
 #include <cmath>
+#include <cstdint>
+#include <limits>
+#ifdef BENCHMARK
+#include <chrono>
+#endif
+
+/*
+ * Finds the largest p such that x = b^p for an integer b. If x = g^E with E maximal then x is a perfect p-th
+ * power exactly when p divides E, and if x = c^q for a prime q then the maximal exponent of x is q times the
+ * maximal exponent of c. It is therefore enough to try the prime exponents q <= 63 with an exact integer root,
+ * multiply q into the answer and continue with the root. For negative x only odd p are possible, which is the odd
+ * part of E. The roots are computed on integers so there is no floating point tolerance involved.
+ * Usage:
+ *      int32_t perf(uint64_t x, bool neg)
+ *
+ *      @param x        : Absolute value of the input.
+ *      @param neg      : True if the input is negative.
+ *      return          : Largest p for which the input is a perfect p-th power.
+ *
+ *      std::vector<int32_t> perf_batch(const std::vector<int64_t>& xs)
+ *
+ *      @param xs       : Signed inputs.
+ *      return          : perf() of every input.
+ */
+
+constexpr int32_t kPrimeExponents[]{2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61};
+
+// True if b^e <= x, the power is then stored in value. Never overflows.
+bool pow_at_most(uint64_t b, int32_t e, uint64_t x, uint64_t& value){
+    value = 1;
+    while(e--){
+        if(b != 0 && value > x / b)
+            return false;
+        value *= b;
+    }
+    return true;
+}
 
-int32_t perf(int64_t x, bool neg){
-    int32_t p{1};
-    int32_t best;
-    double b;
-    do{
-        b = std::pow(x, 1.0/p);
-        if(std::abs(std::round(b) - b) < 0.0001){
-            if(std::pow(round(b), p) == x){
-                b = round(b);
+/*
+ * floor(x^(1/k)). The floating point estimate is off by at most a few units near 2^64, it is corrected with
+ * exact powers.
+ */
+uint64_t iroot(uint64_t x, int32_t k){
+    if(k == 1 || x < 2)
+        return x;
+    auto r = static_cast<uint64_t>(std::pow(static_cast<double>(x), 1.0 / k));
+    uint64_t value;
+    while(r > 0 && !pow_at_most(r, k, x, value))
+        --r;
+    while(pow_at_most(r + 1, k, x, value))
+        ++r;
+    return r;
+}
+
+int32_t perf(uint64_t x, bool neg){
+    int32_t exponent{1};
+    bool reduced{x > 1};
+    while(reduced){
+        reduced = false;
+        for(const auto& q : kPrimeExponents){
+            auto r = iroot(x, q);
+            if(r < 2)
+                break; // Larger exponents have even smaller roots.
+            uint64_t value;
+            if(pow_at_most(r, q, x, value) && value == x){
+                exponent *= q;
+                x = r;
+                reduced = true;
+                break;
             }
         }
-        if(neg){
-            best = (std::floor(b) == b) && (p % 2 != 0) ? p : best;
-        } else{
-            best = std::floor(b) == b ? p : best;
-        }
-        p++;
-    } while(b > 2);
-    return best;
+    }
+    while(neg && exponent % 2 == 0)
+        exponent /= 2;
+    return exponent;
 }
 
+std::vector<int32_t> perf_batch(const std::vector<int64_t>& xs){
+    std::vector<int32_t> result;
+    result.reserve(xs.size());
+    for(const auto& x : xs){
+        auto magnitude = x < 0 ? 0 - static_cast<uint64_t>(x) : static_cast<uint64_t>(x);
+        result.push_back(perf(magnitude, x < 0));
+    }
+    return result;
+}
+
+#ifdef BENCHMARK
+/*
+ * Checks iroot() exhaustively around every power of two for every exponent and measures perf_batch() on random
+ * int64 inputs, build with -DBENCHMARK -O2.
+ */
+int main(){
+    uint64_t checked{0}, value;
+    for(int32_t j{1}; j <= 64; ++j){
+        auto center = j < 64 ? uint64_t{1} << j : std::numeric_limits<uint64_t>::max() - 4096;
+        for(uint64_t x{center > 4096 ? center - 4096 : 1}; x - 1 < center + 4096; ++x){
+            for(int32_t k{2}; k <= 63; ++k){
+                auto r = iroot(x, k);
+                if(!pow_at_most(r, k, x, value) || pow_at_most(r + 1, k, x, value)){
+                    std::cout << "iroot(" << x << ", " << k << ") = " << r << " is wrong\n";
+                    return 1;
+                }
+                ++checked;
+            }
+        }
+    }
+    std::cout << checked << " roots near powers of two verified\n";
+
+    std::vector<int64_t> xs(2'000'000);
+    uint64_t state{88172645463325252ULL};
+    for(size_t i{0}; i < xs.size(); ++i){
+        state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+        auto b = static_cast<int64_t>(state % 2000) + 2;
+        auto e = static_cast<int32_t>(state >> 40) % 8 + 1;
+        int64_t v{1};
+        for(int32_t k{0}; k < e && v <= std::numeric_limits<int64_t>::max() / b; ++k)
+            v *= b;
+        xs[i] = (i % 3 == 0) ? static_cast<int64_t>(state >> 1) : (i % 2 ? -v : v);
+    }
+    auto start = std::chrono::steady_clock::now();
+    auto result = perf_batch(xs);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    int64_t checksum{0};
+    for(const auto& p : result)
+        checksum += p;
+    std::cout << "perf_batch " << xs.size() / elapsed.count() << " inputs/s checksum=" << checksum << "\n";
+}
+#else
 int main() {
     int64_t x;
+    std::vector<int64_t> xs;
     while (std::cin >> x && x) {
-        std::cout << perf(std::abs(x), x < 1) << "\n";
+        xs.push_back(x);
     }
-}
\ No newline at end of file
+    for(const auto& p : perf_batch(xs)){
+        std::cout << p << "\n";
+    }
+}
+#endif
@@ -7,67 +7,366 @@
 #include <cmath>
 #include <algorithm>
 #include <numeric>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <limits>
+#include <cstdio>
+#include <charconv>
+#ifdef BENCHMARK
+#include <chrono>
+#endif
 /*
  * Implementation of a Rational class that handles arithmetic and streaming operators for rational numbers
  * described as a fraction. The following operators are available: +, -, /, *, <, >, <=, >=, ==, !=, <<, >>.
+ * Values are kept normalized with a positive denominator. Numerator and denominator are int64 as long as they fit,
+ * the operators then form their intermediate products in 128 bits and divide out common factors before the result
+ * is built, following Knuth, so the gcds stay on 64-bit values. A result that does not fit in int64 is promoted to
+ * a BigInt fraction on the heap and demoted again once it fits. Comparisons cross multiply exactly.
  * Usage:
  *      Rational(int x, int y)
  *
  *      @param x      : Numerator
- *      @param text   : Denominator
+ *      @param y      : Denominator, y != 0
  *
  */
 
+/*
+ * Arbitrary precision integer as a sign and a magnitude of 32-bit limbs, least significant first. Zero has no
+ * limbs. Only what Rational needs is provided: +, -, *, exact comparisons, division with remainder and the binary
+ * gcd.
+ */
+class BigInt{
+public:
+    BigInt() = default;
+    explicit BigInt(__int128 x) : negative{x < 0}{
+        auto magnitude = x < 0 ? -static_cast<unsigned __int128>(x) : static_cast<unsigned __int128>(x);
+        for(; magnitude; magnitude >>= 32)
+            limbs.push_back(static_cast<uint32_t>(magnitude));
+    }
+
+    bool is_zero() const{ return limbs.empty(); }
+
+    // True if the value lies in (-2^63, 2^63), the range Rational keeps on the fast path.
+    bool fits_int64() const{
+        return limbs.size() < 2 || (limbs.size() == 2 && limbs[1] < (uint32_t{1} << 31));
+    }
+
+    int64_t to_int64() const{
+        uint64_t magnitude{0};
+        for(size_t i{limbs.size()}; i-- > 0;)
+            magnitude = (magnitude << 32) | limbs[i];
+        return negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+    }
+
+    BigInt operator-() const{
+        auto result = *this;
+        result.negative = !is_zero() && !negative;
+        return result;
+    }
+
+    BigInt operator+(const BigInt& other) const{
+        if(negative == other.negative)
+            return make(negative, add(limbs, other.limbs));
+        if(compare(limbs, other.limbs) >= 0)
+            return make(negative, sub(limbs, other.limbs));
+        return make(other.negative, sub(other.limbs, limbs));
+    }
+
+    BigInt operator-(const BigInt& other) const{
+        return *this + -other;
+    }
+
+    BigInt operator*(const BigInt& other) const{
+        return make(negative != other.negative, mul(limbs, other.limbs));
+    }
+
+    // Quotient rounded towards zero.
+    BigInt operator/(const BigInt& other) const{
+        std::vector<uint32_t> remainder;
+        return make(negative != other.negative, divmod(limbs, other.limbs, remainder));
+    }
+
+    bool operator<(const BigInt& other) const{
+        if(negative != other.negative)
+            return negative;
+        auto c = compare(limbs, other.limbs);
+        return negative ? c > 0 : c < 0;
+    }
+
+    bool operator==(const BigInt& other) const{
+        return negative == other.negative && limbs == other.limbs;
+    }
+
+    // gcd(|a|, |b|) with Stein's algorithm, only shifts and subtractions.
+    static BigInt gcd(const BigInt& a, const BigInt& b){
+        if(a.is_zero())
+            return make(false, b.limbs);
+        if(b.is_zero())
+            return make(false, a.limbs);
+        auto u = a.limbs, v = b.limbs;
+        auto zu = trailing_zeros(u), zv = trailing_zeros(v);
+        shift_right(u, zu);
+        shift_right(v, zv);
+        while(true){ // u and v are odd
+            auto c = compare(u, v);
+            if(c == 0)
+                break;
+            if(c > 0)
+                std::swap(u, v);
+            v = sub(v, u);
+            shift_right(v, trailing_zeros(v));
+        }
+        shift_left(u, std::min(zu, zv));
+        return make(false, std::move(u));
+    }
+
+    std::string to_string() const{
+        std::string digits;
+        auto rest = limbs;
+        while(!rest.empty()){
+            uint64_t rem{0};
+            for(size_t i{rest.size()}; i-- > 0;){
+                auto cur = (rem << 32) | rest[i];
+                rest[i] = static_cast<uint32_t>(cur / 1'000'000'000);
+                rem = cur % 1'000'000'000;
+            }
+            trim(rest);
+            for(int32_t d{0}; d < 9 && (rem || !rest.empty()); ++d, rem /= 10)
+                digits.push_back(static_cast<char>('0' + rem % 10));
+        }
+        if(digits.empty())
+            digits = "0";
+        if(negative)
+            digits.push_back('-');
+        std::reverse(digits.begin(), digits.end());
+        return digits;
+    }
+
+private:
+    using Limbs = std::vector<uint32_t>;
+
+    static BigInt make(bool negative, Limbs limbs){
+        trim(limbs);
+        BigInt result;
+        result.negative = negative && !limbs.empty();
+        result.limbs = std::move(limbs);
+        return result;
+    }
+
+    static void trim(Limbs& a){
+        while(!a.empty() && a.back() == 0)
+            a.pop_back();
+    }
+
+    static int32_t compare(const Limbs& a, const Limbs& b){
+        if(a.size() != b.size())
+            return a.size() < b.size() ? -1 : 1;
+        for(size_t i{a.size()}; i-- > 0;)
+            if(a[i] != b[i])
+                return a[i] < b[i] ? -1 : 1;
+        return 0;
+    }
+
+    static Limbs add(const Limbs& a, const Limbs& b){
+        Limbs result(std::max(a.size(), b.size()) + 1);
+        uint64_t carry{0};
+        for(size_t i{0}; i < result.size(); ++i){
+            carry += (i < a.size() ? a[i] : 0) + uint64_t{i < b.size() ? b[i] : 0u};
+            result[i] = static_cast<uint32_t>(carry);
+            carry >>= 32;
+        }
+        trim(result);
+        return result;
+    }
+
+    // |a| - |b| for |a| >= |b|.
+    static Limbs sub(const Limbs& a, const Limbs& b){
+        Limbs result(a.size());
+        int64_t borrow{0};
+        for(size_t i{0}; i < a.size(); ++i){
+            auto cur = static_cast<int64_t>(a[i]) - (i < b.size() ? b[i] : 0) - borrow;
+            borrow = cur < 0;
+            result[i] = static_cast<uint32_t>(cur + (borrow << 32));
+        }
+        trim(result);
+        return result;
+    }
+
+    static Limbs mul(const Limbs& a, const Limbs& b){
+        if(a.empty() || b.empty())
+            return {};
+        Limbs result(a.size() + b.size());
+        for(size_t i{0}; i < a.size(); ++i){
+            uint64_t carry{0};
+            for(size_t j{0}; j < b.size(); ++j){
+                carry += static_cast<uint64_t>(a[i]) * b[j] + result[i + j];
+                result[i + j] = static_cast<uint32_t>(carry);
+                carry >>= 32;
+            }
+            result[i + b.size()] = static_cast<uint32_t>(carry);
+        }
+        trim(result);
+        return result;
+    }
+
+    // Schoolbook division one bit at a time, a single limb divisor takes the short division instead.
+    static Limbs divmod(const Limbs& a, const Limbs& b, Limbs& remainder){
+        Limbs quotient(a.size(), 0);
+        remainder.clear();
+        if(b.size() == 1){
+            uint64_t rem{0};
+            for(size_t i{a.size()}; i-- > 0;){
+                auto cur = (rem << 32) | a[i];
+                quotient[i] = static_cast<uint32_t>(cur / b[0]);
+                rem = cur % b[0];
+            }
+            if(rem)
+                remainder.push_back(static_cast<uint32_t>(rem));
+            trim(quotient);
+            return quotient;
+        }
+        for(size_t bit{a.size() * 32}; bit-- > 0;){
+            shift_left(remainder, 1);
+            if((a[bit / 32] >> (bit % 32)) & 1){
+                if(remainder.empty())
+                    remainder.push_back(0);
+                remainder[0] |= 1;
+            }
+            if(compare(remainder, b) >= 0){
+                remainder = sub(remainder, b);
+                quotient[bit / 32] |= uint32_t{1} << (bit % 32);
+            }
+        }
+        trim(quotient);
+        return quotient;
+    }
+
+    static size_t trailing_zeros(const Limbs& a){
+        size_t i{0};
+        while(a[i] == 0)
+            ++i;
+        return i * 32 + __builtin_ctz(a[i]);
+    }
+
+    static void shift_right(Limbs& a, size_t bits){
+        auto words = bits / 32, rest = bits % 32;
+        a.erase(a.begin(), a.begin() + static_cast<std::ptrdiff_t>(std::min(words, a.size())));
+        if(rest)
+            for(size_t i{0}; i < a.size(); ++i)
+                a[i] = (a[i] >> rest) | (i + 1 < a.size() ? a[i + 1] << (32 - rest) : 0);
+        trim(a);
+    }
+
+    static void shift_left(Limbs& a, size_t bits){
+        if(a.empty())
+            return;
+        auto words = bits / 32, rest = bits % 32;
+        if(rest){
+            a.push_back(0);
+            for(size_t i{a.size()}; i-- > 0;)
+                a[i] = (a[i] << rest) | (i ? a[i - 1] >> (32 - rest) : 0);
+        }
+        a.insert(a.begin(), words, 0);
+        trim(a);
+    }
+
+    bool negative{false};
+    Limbs limbs;
+};
+
+inline int32_t trailing_zeros(uint64_t x){ return __builtin_ctzll(x); }
+inline int32_t trailing_zeros(unsigned __int128 x){
+    auto low = static_cast<uint64_t>(x);
+    return low ? __builtin_ctzll(low) : 64 + __builtin_ctzll(static_cast<uint64_t>(x >> 64));
+}
+
+// Stein's binary gcd, shifts and subtractions replace the divisions of Euclid's algorithm.
+template<typename T>
+T binary_gcd(T a, T b){
+    if(!a || !b)
+        return a | b;
+    auto shift = trailing_zeros(a | b);
+    a >>= trailing_zeros(a);
+    while(b){
+        b >>= trailing_zeros(b);
+        if(a > b)
+            std::swap(a, b);
+        b -= a;
+    }
+    return a << shift;
+}
+
 class Rational{
 public:
-    Rational() : num{}, den{} {}
+    Rational() : num{0}, den{1} {}
     Rational(int64_t x, int64_t y){
-        auto gcd = std::gcd(x, y); // x0 = x1 = 0 -> gdc = 0
-        if(!gcd)
-            gcd = 1;
-        num = x / gcd;
-        den = std::abs(y / gcd);
-        if(y < 0){
-            num = -num;
-        }
+        *this = make(static_cast<__int128>(x), static_cast<__int128>(y));
     }
 
     Rational operator+(const Rational& other) const{
-        auto d = den*other.den;
-        return {num*other.den + other.num * den, d};
+        if(big || other.big){
+            auto x = to_big(), y = other.to_big();
+            return make(x.num * y.den + y.num * x.den, x.den * y.den);
+        }
+        return add(num, den, other.num, other.den);
     }
 
     Rational operator-(const Rational& other) const{
-        auto d = den*other.den;
-        return {num*other.den - other.num * den, d};
+        if(big || other.big){
+            auto x = to_big(), y = other.to_big();
+            return make(x.num * y.den - y.num * x.den, x.den * y.den);
+        }
+        return add(num, den, -other.num, other.den);
     }
 
     Rational operator/(const Rational& other) const{
-        return {num * other.den,den*other.num};
+        if(big || other.big){
+            auto x = to_big(), y = other.to_big();
+            return make(x.num * y.den, x.den * y.num);
+        }
+        return other.num < 0 ? mul(num, den, -other.den, -other.num) : mul(num, den, other.den, other.num);
     }
 
     Rational operator*(const Rational& other) const{
-        return {num*other.num, den*other.den};
+        if(big || other.big){
+            auto x = to_big(), y = other.to_big();
+            return make(x.num * y.num, x.den * y.den);
+        }
+        return mul(num, den, other.num, other.den);
     }
 
-    bool operator<(const Rational& other) const{
+    // Sign of this - other, exact. The cross products of int64 values fit in 128 bits.
+    int32_t compare(const Rational& other) const{
+        if(big || other.big){
+            auto x = to_big(), y = other.to_big();
+            auto lhs = x.num * y.den, rhs = y.num * x.den;
+            return lhs < rhs ? -1 : rhs < lhs ? 1 : 0;
+        }
+        auto lhs = static_cast<__int128>(num) * other.den, rhs = static_cast<__int128>(other.num) * den;
+        return lhs < rhs ? -1 : lhs > rhs ? 1 : 0;
+    }
 
-        return (double)num/den < (double)other.num/other.den;
+    bool operator<(const Rational& other) const{
+        return compare(other) < 0;
     }
 
     bool operator>(const Rational& other) const{
-        return (double)num/den > (double)other.num/other.den;
+        return compare(other) > 0;
     }
 
     bool operator<=(const Rational& other) const{
-        return (double)num/den <= (double)other.num/other.den;
+        return compare(other) <= 0;
     }
 
     bool operator>=(const Rational& other) const{
-        return (double)num/den >= (double)other.num/other.den;
+        return compare(other) >= 0;
     }
 
+    // Both sides are normalized, so equal values have equal representations.
     bool operator==(const Rational& other) const{
+        if(big || other.big)
+            return big && other.big && big->num == other.big->num && big->den == other.big->den;
         return num == other.num && den == other.den;
     }
 
@@ -75,49 +374,359 @@ public:
         return !(*this == other);
     }
 
+    bool is_big() const{ return big != nullptr; }
+
+    // x / y from 128-bit values, so that x or y = INT64_MIN can be negated.
+    static Rational make(__int128 x, __int128 y){
+        auto magnitude = [](__int128 v){ return v < 0 ? -static_cast<unsigned __int128>(v) : static_cast<unsigned __int128>(v); };
+        auto u = magnitude(x), v = magnitude(y);
+        auto gcd = (u | v) >> 64 ? static_cast<__int128>(binary_gcd(u, v))
+                                 : static_cast<__int128>(binary_gcd(static_cast<uint64_t>(u), static_cast<uint64_t>(v)));
+        if(!gcd) // x0 = x1 = 0 -> gcd = 0
+            gcd = 1;
+        return y < 0 ? reduced(-x / gcd, -y / gcd) : reduced(x / gcd, y / gcd);
+    }
+
+    std::string to_string() const{
+        if(big)
+            return big->num.to_string() + " / " + big->den.to_string();
+        return std::to_string(num) + " / " + std::to_string(den);
+    }
+
+    // Valid while !is_big(), otherwise the value is held by big.
     int64_t num;
     int64_t den;
+
+private:
+    struct BigFraction{
+        BigInt num, den;
+    };
+
+    BigFraction to_big() const{
+        if(big)
+            return *big;
+        return {BigInt{num}, BigInt{den}};
+    }
+
+    static bool fits(__int128 x){
+        return x > -(static_cast<__int128>(1) << 63) && x < (static_cast<__int128>(1) << 63);
+    }
+
+    // x / y for a reduced fraction with y > 0.
+    static Rational reduced(__int128 x, __int128 y){
+        Rational result;
+        if(fits(x) && fits(y)){
+            result.num = static_cast<int64_t>(x);
+            result.den = static_cast<int64_t>(y);
+        }else{
+            result.big = std::make_shared<const BigFraction>(BigFraction{BigInt{x}, BigInt{y}});
+        }
+        return result;
+    }
+
+    static Rational make(BigInt x, BigInt y){
+        auto gcd = BigInt::gcd(x, y);
+        if(!gcd.is_zero()){
+            x = x / gcd;
+            y = y / gcd;
+        }
+        if(y < BigInt{}){
+            x = -x;
+            y = -y;
+        }
+        if(x.fits_int64() && y.fits_int64())
+            return reduced(x.to_int64(), y.to_int64());
+        Rational result;
+        result.big = std::make_shared<const BigFraction>(BigFraction{std::move(x), std::move(y)});
+        return result;
+    }
+
+    /*
+     * a/b + c/d with b, d > 0. With g = gcd(b, d) and t = a*(d/g) + c*(b/g) the sum is reduced by gcd(t, g) alone,
+     * which is a gcd of 64-bit values since t mod g is.
+     */
+    static Rational add(int64_t a, int64_t b, int64_t c, int64_t d){
+        auto g = std::gcd(b, d);
+        auto t = static_cast<__int128>(a) * (d / g) + static_cast<__int128>(c) * (b / g);
+        if(t == 0)
+            return reduced(0, 1);
+        auto g2 = std::gcd(static_cast<int64_t>(t % g), g);
+        return reduced(t / g2, static_cast<__int128>(b / g) * (d / g2));
+    }
+
+    // a/b * c/d with b, d > 0, the cross gcds leave the product reduced.
+    static Rational mul(int64_t a, int64_t b, int64_t c, int64_t d){
+        if(a == 0 || c == 0)
+            return reduced(0, 1);
+        auto g1 = std::gcd(a, d), g2 = std::gcd(c, b);
+        return reduced(static_cast<__int128>(a / g1) * (c / g2), static_cast<__int128>(b / g2) * (d / g1));
+    }
+
+    std::shared_ptr<const BigFraction> big;
 };
 
 std::ostream& operator<<(std::ostream& os, const Rational& rt){
-    std::cout << rt.num << " / " << rt.den;
+    os << rt.to_string();
     return os;
 }
 
 std::istream& operator>>(std::istream& is, Rational& rt){
-    is >> rt.num >> rt.den;
+    int64_t x, y;
+    if(is >> x >> y)
+        rt = Rational{x, y};
     return is;
 }
 
 
-int main(){
-    int32_t n,x1,x2,y1,y2;
-    char op;
-    std::cin >> n;
-
-    while(n--){
-        std::cin >> x1 >> y1 >> op >> x2 >> y2;
-        Rational a{x1, y1};
-        Rational b{x2, y2};
-        Rational res;
-        switch(op){
-            case '+':
-                res = a + b;
-                break;
-            case '-':
-                res = a - b;
-                break;
-            case '/':
-                res = a / b;
-                break;
-            case '*':
-                res = a * b;
-                break;
-            default:
-                break;
+/*
+ * Accumulates a long sum of Rationals without normalizing after every term. The pending sum is kept as an
+ * unreduced 128-bit fraction, a term with the same denominator only adds its numerator and other terms cross
+ * multiply. Only when the numerator or denominator reaches kLimit is the fraction reduced with the binary gcd, and if
+ * it is still too large it is moved into an exact Rational, which may then be a BigInt.
+ * Usage:
+ *      RationalSum += Rational, RationalSum -= Rational
+ *
+ *      Rational value()
+ *
+ *      return          : The normalized sum of all terms.
+ */
+class RationalSum{
+public:
+    RationalSum& operator+=(const Rational& term){
+        if(term.is_big()){
+            spilled = spilled + term;
+            return *this;
         }
-        std::cout << res << "\n";
+        add(term.num, term.den);
+        return *this;
+    }
+
+    RationalSum& operator-=(const Rational& term){
+        if(term.is_big()){
+            spilled = spilled - term;
+            return *this;
+        }
+        add(-term.num, term.den);
+        return *this;
+    }
+
+    Rational value() const{
+        return spilled + Rational::make(num, den);
+    }
+
+private:
+    // |num| and den stay below kLimit, so the cross products of a new term fit in 128 bits.
+    static constexpr __int128 kLimit{static_cast<__int128>(1) << 63};
+
+    void add(int64_t x, int64_t y){
+        if(y == den){
+            num += x;
+        }else{
+            num = num * y + x * den;
+            den *= y;
+        }
+        if(num > -kLimit && num < kLimit && den < kLimit)
+            return;
+
+        auto gcd = binary_gcd(static_cast<unsigned __int128>(num < 0 ? -num : num), static_cast<unsigned __int128>(den));
+        num /= static_cast<__int128>(gcd);
+        den /= static_cast<__int128>(gcd);
+        if(num > -kLimit && num < kLimit && den < kLimit)
+            return;
+        spilled = spilled + Rational::make(num, den);
+        num = 0;
+        den = 1;
+    }
+
+    __int128 num{0}, den{1};
+    Rational spilled;
+};
+
+/*
+ * The operations of the problem as columns, operation i is (x1[i] / y1[i]) op[i] (x2[i] / y2[i]).
+ */
+struct RationalColumns{
+    std::vector<int32_t> x1, y1, x2, y2;
+    std::vector<char> op;
+};
+
+/*
+ * Evaluates every operation in two passes over the columns. With all operands above INT32_MIN the unreduced
+ * numerator and denominator fit in int64, so the first pass only multiplies and adds. The second pass normalizes
+ * each fraction with one binary gcd. The rare rows with an operand INT32_MIN go through Rational.
+ * Usage:
+ *      evaluate(RationalColumns in, int[] num, int[] den)
+ *
+ *      @param in       : Operations, every denominator and every divisor non zero.
+ *      @param num, den : Normalized result of every operation, den > 0.
+ */
+void evaluate(const RationalColumns& in, std::vector<int64_t>& num, std::vector<int64_t>& den){
+    constexpr int64_t kMin{std::numeric_limits<int32_t>::min()};
+    auto t = in.op.size();
+    num.resize(t);
+    den.resize(t);
+    for(size_t i{0}; i < t; ++i){
+        int64_t a{in.x1[i]}, b{in.y1[i]}, c{in.x2[i]}, d{in.y2[i]};
+        if(a == kMin || b == kMin || c == kMin || d == kMin){ // The sum of the products could reach 2^63.
+            Rational x{a, b}, y{c, d};
+            auto op = in.op[i];
+            auto r = op == '+' ? x + y : op == '-' ? x - y : op == '*' ? x * y : x / y;
+            num[i] = r.num;
+            den[i] = r.den;
+            continue;
+        }
+        switch(in.op[i]){
+            case '+': num[i] = a * d + c * b; den[i] = b * d; break;
+            case '-': num[i] = a * d - c * b; den[i] = b * d; break;
+            case '*': num[i] = a * c; den[i] = b * d; break;
+            default:  num[i] = a * d; den[i] = b * c; break;
+        }
+    }
+    for(size_t i{0}; i < t; ++i){
+        auto x = num[i], y = den[i];
+        auto gcd = static_cast<int64_t>(binary_gcd(static_cast<uint64_t>(x < 0 ? -x : x), static_cast<uint64_t>(y < 0 ? -y : y)));
+        if(!gcd)
+            gcd = 1;
+        if(y < 0)
+            gcd = -gcd;
+        num[i] = x / gcd;
+        den[i] = y / gcd;
     }
-    return 0;
 }
 
+#ifdef BENCHMARK
+/*
+ * Throughput on random operations with operands up to 10^9 as in the problem, one Rational at a time and as columns
+ * through evaluate(), on a telescoping chain sum 1/(i(i+1)) whose partial sums stay small but whose unreduced
+ * products overflow at once, with Rational and with RationalSum, and on the harmonic sum whose denominators outgrow
+ * int64 and are carried as BigInt. Build with -DBENCHMARK -O2.
+ */
+int main(){
+    constexpr int32_t kOps{2'000'000};
+    uint64_t state{88172645463325252ULL};
+    auto next = [&](){
+        state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+        return static_cast<int64_t>(state % 2'000'000'001) - 1'000'000'000;
+    };
+    RationalColumns columns;
+    for(int32_t i{0}; i < kOps; ++i){
+        auto x1 = next(), y1 = next(), x2 = next(), y2 = next();
+        columns.x1.push_back(static_cast<int32_t>(x1));
+        columns.y1.push_back(static_cast<int32_t>(y1 ? y1 : 1));
+        columns.x2.push_back(static_cast<int32_t>(x2 ? x2 : 1));
+        columns.y2.push_back(static_cast<int32_t>(y2 ? y2 : 1));
+        columns.op.push_back("+-*/"[state >> 62]);
+    }
+    auto start = std::chrono::steady_clock::now();
+    int64_t checksum{0};
+    for(int32_t i{0}; i < kOps; ++i){
+        Rational a{columns.x1[i], columns.y1[i]};
+        Rational b{columns.x2[i], columns.y2[i]};
+        auto op = columns.op[i];
+        auto res = op == '+' ? a + b : op == '-' ? a - b : op == '*' ? a * b : a / b;
+        checksum += res.is_big() ? 1 : res.num ^ res.den;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "random   " << kOps / elapsed.count() << " ops/s checksum=" << checksum << "\n";
+
+    start = std::chrono::steady_clock::now();
+    std::vector<int64_t> num, den;
+    evaluate(columns, num, den);
+    checksum = 0;
+    for(int32_t i{0}; i < kOps; ++i)
+        checksum += num[i] ^ den[i];
+    elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "columns  " << kOps / elapsed.count() << " ops/s checksum=" << checksum << "\n";
+
+    start = std::chrono::steady_clock::now();
+    Rational telescoping{0, 1};
+    for(int64_t i{1}; i <= kOps; ++i)
+        telescoping = telescoping + Rational{1, i * (i + 1)};
+    elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "telescoping " << kOps / elapsed.count() << " ops/s sum=" << telescoping
+              << (telescoping == Rational{kOps, kOps + 1} ? " exact" : " WRONG") << "\n";
+
+    start = std::chrono::steady_clock::now();
+    RationalSum lazy;
+    for(int64_t i{1}; i <= kOps; ++i)
+        lazy += Rational{1, i * (i + 1)};
+    elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "telescoping RationalSum " << kOps / elapsed.count() << " ops/s sum=" << lazy.value()
+              << (lazy.value() == Rational{kOps, kOps + 1} ? " exact" : " WRONG") << "\n";
+
+    start = std::chrono::steady_clock::now();
+    Rational eager;
+    for(int64_t i{1}; i <= kOps; ++i)
+        eager = eager + Rational{static_cast<int64_t>(i % 7) - 3, 1 + i % 12};
+    elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "small denominators " << kOps / elapsed.count() << " ops/s sum=" << eager << "\n";
+
+    start = std::chrono::steady_clock::now();
+    RationalSum deferred;
+    for(int64_t i{1}; i <= kOps; ++i)
+        deferred += Rational{static_cast<int64_t>(i % 7) - 3, 1 + i % 12};
+    elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "small denominators RationalSum " << kOps / elapsed.count() << " ops/s sum=" << deferred.value()
+              << "\n";
+
+    start = std::chrono::steady_clock::now();
+    Rational harmonic{0, 1};
+    constexpr int32_t kTerms{3000};
+    for(int64_t i{1}; i <= kTerms; ++i)
+        harmonic = harmonic + Rational{1, i};
+    elapsed = std::chrono::steady_clock::now() - start;
+    auto digits = harmonic.to_string();
+    std::cout << "harmonic " << kTerms / elapsed.count() << " ops/s, H_" << kTerms << " has "
+              << digits.size() - digits.find('/') - 2 << " denominator digits, H_" << kTerms
+              << (Rational{8, 1} < harmonic && harmonic < Rational{9, 1} ? " in (8, 9)" : " WRONG") << "\n";
+}
+#else
+int main(){
+    // The whole input is parsed into columns and the whole output written at once.
+    std::string input;
+    char chunk[1 << 16];
+    for(size_t got; (got = std::fread(chunk, 1, sizeof(chunk), stdin)) > 0;)
+        input.append(chunk, got);
+    const char* at{input.data()};
+    const char* end{input.data() + input.size()};
+    auto skip = [&](){
+        while(at < end && (*at == ' ' || *at == '\n' || *at == '\r' || *at == '\t'))
+            ++at;
+    };
+    auto next_int = [&](){
+        skip();
+        int32_t v{0};
+        auto res = std::from_chars(at + (at < end && *at == '+'), end, v);
+        at = res.ptr;
+        return v;
+    };
+
+    auto n = next_int();
+    RationalColumns in;
+    for(auto* column : {&in.x1, &in.y1, &in.x2, &in.y2})
+        column->reserve(n);
+    in.op.reserve(n);
+    for(int32_t i{0}; i < n; ++i){
+        in.x1.push_back(next_int());
+        in.y1.push_back(next_int());
+        skip();
+        in.op.push_back(at < end ? *at++ : '+');
+        in.x2.push_back(next_int());
+        in.y2.push_back(next_int());
+    }
+
+    std::vector<int64_t> num, den;
+    evaluate(in, num, den);
+    std::string output;
+    output.reserve(static_cast<size_t>(n) * 24);
+    char digits[24];
+    for(int32_t i{0}; i < n; ++i){
+        output.append(digits, std::to_chars(digits, digits + sizeof(digits), num[i]).ptr);
+        output.append(" / ");
+        output.append(digits, std::to_chars(digits, digits + sizeof(digits), den[i]).ptr);
+        output.push_back('\n');
+    }
+    std::fwrite(output.data(), 1, output.size(), stdout);
+    return 0;
+}
+#endif
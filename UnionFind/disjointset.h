@@ -0,0 +1,135 @@
+#ifndef UNIONFIND_DISJOINTSET_H
+#define UNIONFIND_DISJOINTSET_H
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*
+ * Disjoint set union over the elements 0..N-1. Parents and sizes share one int32 array: a root holds the negative
+ * size of its set and every other element holds its parent, so a find touches a single array. Sets are joined by
+ * size and find() halves the path by pointing every visited element at its grandparent, without recursion. Together
+ * this gives amortized inverse Ackermann time per operation and O(N) memory.
+ * Usage:
+ *      int32_t find(int32_t a)
+ *
+ *      @param a    : Element to find the root of, 0 <= a < N.
+ *      @return     : Root of the set holding a.
+ *
+ *      bool unite(int32_t a, int32_t b)
+ *
+ *      @param a, b : Elements whose sets are joined.
+ *      @return     : True if they were in different sets.
+ *
+ *      bool same(int32_t a, int32_t b)
+ *
+ *      @return     : True if a and b are in the same set.
+ *
+ *      int32_t size(int32_t a)
+ *
+ *      @return     : Number of elements in the set holding a.
+ *
+ * RollbackDisjointSet has the same operations plus snapshot() and rollback(), for offline algorithms that undo
+ * unions in last in, first out order. It never compresses paths, union by size alone keeps find() at O(logN).
+ */
+
+class DisjointSet{
+public:
+    explicit DisjointSet(int32_t N = 0) : data(N, -1), sets{N}{}
+
+    int32_t find(int32_t a){
+        while(data[a] >= 0){
+            if(data[data[a]] >= 0)
+                data[a] = data[data[a]];
+            a = data[a];
+        }
+        return a;
+    }
+
+    bool unite(int32_t a, int32_t b){
+        a = find(a);
+        b = find(b);
+        if(a == b)
+            return false;
+        if(data[a] > data[b]) // Sizes are negative, a is the smaller set.
+            std::swap(a, b);
+        data[a] += data[b];
+        data[b] = a;
+        --sets;
+        return true;
+    }
+
+    bool same(int32_t a, int32_t b){
+        return find(a) == find(b);
+    }
+
+    int32_t size(int32_t a){
+        return -data[find(a)];
+    }
+
+    // Number of disjoint sets.
+    int32_t count() const{
+        return sets;
+    }
+
+private:
+    std::vector<int32_t> data;
+    int32_t sets;
+};
+
+class RollbackDisjointSet{
+public:
+    explicit RollbackDisjointSet(int32_t N = 0) : data(N, -1){}
+
+    int32_t find(int32_t a) const{
+        while(data[a] >= 0)
+            a = data[a];
+        return a;
+    }
+
+    /*
+     * Records the old value of both changed cells, also when nothing changes so that every unite() is undone by
+     * one rollback step.
+     */
+    bool unite(int32_t a, int32_t b){
+        a = find(a);
+        b = find(b);
+        if(data[a] > data[b])
+            std::swap(a, b);
+        history.emplace_back(a, data[a]);
+        history.emplace_back(b, data[b]);
+        if(a == b)
+            return false;
+        data[a] += data[b];
+        data[b] = a;
+        return true;
+    }
+
+    bool same(int32_t a, int32_t b) const{
+        return find(a) == find(b);
+    }
+
+    int32_t size(int32_t a) const{
+        return -data[find(a)];
+    }
+
+    // State to pass to rollback(), the number of unite() calls made so far.
+    size_t snapshot() const{
+        return history.size() / 2;
+    }
+
+    // Undoes every unite() made after the given snapshot.
+    void rollback(size_t snapshot){
+        while(history.size() > snapshot * 2){
+            data[history.back().first] = history.back().second;
+            history.pop_back();
+        }
+    }
+
+private:
+    std::vector<int32_t> data;
+    std::vector<std::pair<int32_t, int32_t>> history;
+};
+
+#endif //UNIONFIND_DISJOINTSET_H
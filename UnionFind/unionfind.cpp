@@ -4,6 +4,12 @@
 
 #include <algorithm>
 #include <vector>
+#include <numeric>
+#include <iostream>
+#include "disjointset.h"
+#ifdef BENCHMARK
+#include <chrono>
+#endif
 /*
  * Union finder which supplies three functions: find_parent(), same() and union_set(). Allowing
  * a user to combine any two sets, find what set a specific element is in and find if two elements
@@ -29,6 +35,9 @@
  *      @param b    : second set element to check with
  *      @param p    : vector of direct ancestors
  *      @return     : true if elements are apart off the same set, false otherwise.
+ *
+ * The class based DisjointSet and RollbackDisjointSet in disjointset.h keep parents and sizes in one array and
+ * find iteratively, they are what other solutions include.
  */
 
 
@@ -73,26 +82,89 @@ bool same(uint32_t a, uint32_t b, std::vector<uint32_t>& parents){
 }
 
 
+#ifdef BENCHMARK
+/*
+ * DisjointSet against the free functions on 10^6 elements and 4 * 10^6 random unions and queries, whose answers are
+ * compared, and RollbackDisjointSet undoing every union. Build with -DBENCHMARK -O2.
+ */
+int main(){
+    constexpr int32_t N{1'000'000}, Q{4'000'000};
+    uint64_t state{88172645463325252ULL};
+    auto next = [&](){
+        state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+        return state;
+    };
+    struct Op{
+        bool unite;
+        uint32_t a, b;
+    };
+    std::vector<Op> ops(Q);
+    for(auto& op : ops)
+        op = {next() % 2 == 0, static_cast<uint32_t>(next() % N), static_cast<uint32_t>(next() % N)};
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint32_t> parents(N);
+    std::vector<uint32_t> size(N, 1);
+    std::iota(parents.begin(), parents.end(), 0);
+    std::vector<char> expected;
+    for(const auto& op : ops){
+        if(op.unite)
+            union_sets(op.a, op.b, parents, size);
+        else
+            expected.push_back(same(op.a, op.b, parents));
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    auto functions = elapsed.count();
+    std::cout << "functions    " << functions << " s\n";
+
+    start = std::chrono::steady_clock::now();
+    DisjointSet dsu(N);
+    std::vector<char> answers;
+    for(const auto& op : ops){
+        if(op.unite)
+            dsu.unite(op.a, op.b);
+        else
+            answers.push_back(dsu.same(op.a, op.b));
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "DisjointSet  " << elapsed.count() << " s, " << functions / elapsed.count() << "x "
+              << (answers == expected ? "ok" : "MISMATCH") << "\n";
+
+    start = std::chrono::steady_clock::now();
+    RollbackDisjointSet rollback(N);
+    answers.clear();
+    for(const auto& op : ops){
+        if(op.unite)
+            rollback.unite(op.a, op.b);
+        else
+            answers.push_back(rollback.same(op.a, op.b));
+    }
+    rollback.rollback(0);
+    elapsed = std::chrono::steady_clock::now() - start;
+    bool ok{answers == expected && rollback.size(0) == 1 && !rollback.same(ops[0].a, ops[0].b)};
+    std::cout << "rollback     " << elapsed.count() << " s " << (ok ? "ok" : "MISMATCH") << "\n";
+    return ok ? 0 : 1;
+}
+#endif
+
 /*
 int main(){
     std::ios::sync_with_stdio(false);
     std::cin.tie(nullptr);
 
-    uint32_t N, Q;
+    int32_t N, Q;
     std::cin >> N >> Q;
 
-    std::vector<uint32_t> parents(N);
-    std::vector<uint32_t> size(N, 1);
-    std::iota(parents.begin(), parents.end(), 0);
+    DisjointSet dsu(N);
 
     char op;
-    uint32_t a,b;
-    for(uint32_t i{0}; i < Q; ++i){
+    int32_t a,b;
+    for(int32_t i{0}; i < Q; ++i){
         std::cin >> op >> a >> b;
         if(op == '='){
-            union_sets(a,b, parents, size);
+            dsu.unite(a, b);
         } else {
-            auto output = same(a,b,parents) ? "yes" : "no";
+            auto output = dsu.same(a, b) ? "yes" : "no";
             std::cout << output << "\n";
         }
 